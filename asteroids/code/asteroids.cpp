@@ -0,0 +1,2051 @@
+#include "asteroids.h"
+
+#include <string.h>
+
+// Screen resolution
+int screenWidth = 1024;
+int screenHeight = 768;
+
+// Getting radius of screen windows for asteroid spawn
+float screenRadius = sqrtf((screenWidth * screenWidth) + (screenHeight * screenHeight)) / 2;
+
+// Spawn margin so asteroid will not spawn within the screen
+float spawnMargin = 50.0f;
+
+// Few hits per bullet, highest index first like the brute force pass
+static void
+insertionSortDescending(int *values, int count)
+{
+    for(int k = 1;
+        k < count;
+        k++)
+    {
+        int value = values[k];
+        int m = k - 1;
+        while(m >= 0 && values[m] < value)
+        {
+            values[m + 1] = values[m];
+            m--;
+        }
+        values[m + 1] = value;
+    }
+}
+
+// NOTE(trist007): swept circle test. Both circles move in a straight line
+// over the tick, so seen from the asteroid the bullet runs along start +
+// t * delta for t in [0, 1] and hits when the closest point of that segment
+// is within reach. Past the ends that's the end points, in between it's
+// |start|^2 - (start.delta)^2 / |delta|^2 < reach^2, multiplied out by
+// |delta|^2 so there's no divide. Same operations in the same order as the
+// SIMD lanes of sweptOverlapAsteroidsMask, which only gives the same answers
+// while the compiler isn't allowed to reassociate (see build.sh).
+static inline bool
+sweptCircleHit(float fromX, float fromY, float moveX, float moveY,
+               float x, float y, float prevX, float prevY, float reach)
+{
+    float startX = fromX - prevX;
+    float startY = fromY - prevY;
+    float deltaX = moveX - (x - prevX);
+    float deltaY = moveY - (y - prevY);
+    float endX = startX + deltaX;
+    float endY = startY + deltaY;
+    float reach2 = reach * reach;
+    float startDistance = startX * startX + startY * startY;
+    float endDistance = endX * endX + endY * endY;
+    float along = startX * deltaX + startY * deltaY;
+    float length = deltaX * deltaX + deltaY * deltaY;
+    bool result = (startDistance < reach2) | (endDistance < reach2) |
+                  ((along < 0) & (along > -length) & ((startDistance - reach2) * length < along * along));
+    return(result);
+}
+
+// The bullet against one asteroid, at the end of the tick or over all of it
+static bool
+bulletHitsAsteroid(GameState *gs, Bullet *bullet, int j)
+{
+    AsteroidPool *asteroids = &gs->asteroids;
+    float reach = asteroids->radius[j] + gs->bulletRadius;
+    bool result;
+    if(gs->config.sweptCollision)
+    {
+        result = sweptCircleHit(bullet->prevPos.x, bullet->prevPos.y, bullet->pos.x - bullet->prevPos.x,
+                                bullet->pos.y - bullet->prevPos.y, asteroids->x[j], asteroids->y[j],
+                                asteroids->prevX[j], asteroids->prevY[j], reach);
+    }
+    else
+    {
+        float dx = asteroids->x[j] - bullet->pos.x;
+        float dy = asteroids->y[j] - bullet->pos.y;
+        result = (dx * dx + dy * dy) < reach * reach;
+    }
+    return(result);
+}
+
+// The bullet against asteroids [first, first + count), bits in hitMask
+static int
+bulletOverlapsMask(GameState *gs, Bullet *bullet, int first, int count, unsigned long long *hitMask)
+{
+    AsteroidPool *asteroids = &gs->asteroids;
+    int result;
+    if(gs->config.sweptCollision)
+    {
+        result = sweptOverlapAsteroidsMask(asteroids->x + first, asteroids->y + first, asteroids->prevX + first,
+                                           asteroids->prevY + first, asteroids->radius + first, count,
+                                           bullet->prevPos.x, bullet->prevPos.y, bullet->pos.x, bullet->pos.y,
+                                           gs->bulletRadius, hitMask);
+    }
+    else
+    {
+        result = overlapAsteroidsMask(asteroids->x + first, asteroids->y + first, asteroids->radius + first, count,
+                                      bullet->pos.x, bullet->pos.y, gs->bulletRadius, hitMask);
+    }
+    return(result);
+}
+
+// NOTE(trist007): the grid and sweep broadphases find candidates with a
+// plain circle test. For swept collision that circle sits halfway along
+// the bullet's path and is padded by half the longest bullet step and the
+// longest asteroid step, which takes in everything that could touch a
+// bullet at some point in the tick. The swept test has the final say. 0
+// when collision isn't swept, the circle is then the bullet itself.
+static float
+sweptCandidatePad(GameState *gs)
+{
+    float result = 0;
+    if(gs->config.sweptCollision)
+    {
+        AsteroidPool *asteroids = &gs->asteroids;
+        BulletPool *bullets = &gs->bullets;
+        float asteroidStep = 0;
+        for(int i = 0;
+            i < asteroids->count;
+            i++)
+        {
+            float dx = asteroids->x[i] - asteroids->prevX[i];
+            float dy = asteroids->y[i] - asteroids->prevY[i];
+            float step = dx * dx + dy * dy;
+            asteroidStep = (step > asteroidStep) ? step : asteroidStep;
+        }
+        
+        float bulletStep = 0;
+        for(int word = 0;
+            word < bullets->maskWords;
+            word++)
+        {
+            unsigned long long bits = bullets->activeMask[word];
+            while(bits)
+            {
+                int i = word * 64 + findLeastSignificantSetBit(bits);
+                bits &= bits - 1;
+                float step = Vector2LengthSqr(Vector2Subtract(bullets->bullet[i].pos, bullets->bullet[i].prevPos));
+                bulletStep = (step > bulletStep) ? step : bulletStep;
+            }
+        }
+        
+        // Plus a pixel so rounding in the candidate test can't lose a graze
+        result = 0.5f * sqrtf(bulletStep) + sqrtf(asteroidStep) + 1.0f;
+    }
+    return(result);
+}
+
+// Where the candidate circle goes for a bullet, see sweptCandidatePad
+static Vector2
+bulletCandidateCenter(GameState *gs, Bullet *bullet)
+{
+    Vector2 result = bullet->pos;
+    if(gs->config.sweptCollision) result = Vector2Scale(Vector2Add(bullet->prevPos, bullet->pos), 0.5f);
+    return(result);
+}
+
+// NOTE(trist007): in a wrapping world the bullet also gets tested as an
+// image, shifted a world width and/or height, towards each seam its
+// candidate circle comes within wrapReach of. Plain distances to the images
+// are the minimum image distances, and every broadphase and kernel works as
+// it is. An asteroid can turn up once per image, see wrapImages. wrapReach is the
+// candidate radius plus the biggest asteroid's, 0 when the world doesn't
+// wrap. image[0] is always the bullet itself.
+static float
+bulletWrapReach(GameState *gs)
+{
+    float result = 0;
+    if(gs->config.wrapWorld)
+    {
+        AsteroidPool *asteroids = &gs->asteroids;
+        float maxRadius = 0;
+        for(int i = 0;
+            i < asteroids->count;
+            i++)
+        {
+            maxRadius = (asteroids->radius[i] > maxRadius) ? asteroids->radius[i] : maxRadius;
+        }
+        result = maxRadius + gs->bulletRadius + sweptCandidatePad(gs);
+    }
+    return(result);
+}
+
+// Same for the ship against every asteroid, swept along both their steps
+static float
+shipWrapReach(GameState *gs)
+{
+    AsteroidPool *asteroids = &gs->asteroids;
+    Ship *ship = &gs->ship;
+    float maxRadius = 0;
+    float asteroidStep = 0;
+    for(int i = 0;
+        i < asteroids->count;
+        i++)
+    {
+        float dx = asteroids->x[i] - asteroids->prevX[i];
+        float dy = asteroids->y[i] - asteroids->prevY[i];
+        float step = dx * dx + dy * dy;
+        asteroidStep = (step > asteroidStep) ? step : asteroidStep;
+        maxRadius = (asteroids->radius[i] > maxRadius) ? asteroids->radius[i] : maxRadius;
+    }
+    
+    float result = ship->size + maxRadius;
+    if(gs->config.sweptCollision)
+    {
+        result += sqrtf(asteroidStep) + Vector2Length(Vector2Subtract(ship->pos, ship->prevPos));
+    }
+    return(result);
+}
+
+// Brings a point that left the wrapping world back in on the other side,
+// along with where it was last tick
+static void
+wrapPoint(Vector2 *pos, Vector2 *prevPos)
+{
+    Vector2 shift = { 0, 0 };
+    if(pos->x < 0) shift.x = (float)screenWidth;
+    if(pos->x >= screenWidth) shift.x = -(float)screenWidth;
+    if(pos->y < 0) shift.y = (float)screenHeight;
+    if(pos->y >= screenHeight) shift.y = -(float)screenHeight;
+    *pos = Vector2Add(*pos, shift);
+    *prevPos = Vector2Add(*prevPos, shift);
+}
+
+static int
+bulletImages(GameState *gs, Bullet *bullet, float wrapReach, Bullet *image)
+{
+    Vector2 offset[WRAP_MAX_IMAGES];
+    int imageCount = wrapImages(&gs->config, bulletCandidateCenter(gs, bullet), wrapReach, offset);
+    for(int m = 0;
+        m < imageCount;
+        m++)
+    {
+        image[m] = *bullet;
+        image[m].pos = Vector2Add(bullet->pos, offset[m]);
+        image[m].prevPos = Vector2Add(bullet->prevPos, offset[m]);
+    }
+    return(imageCount);
+}
+
+// Asteroids in [first, first + count) hit by any of the images, each image's
+// from the highest index down
+static int
+bulletHitList(GameState *gs, Bullet *image, int imageCount, int first, int count, unsigned long long *hitMask,
+              int *hitIndex)
+{
+    int hitCount = 0;
+    for(int m = 0;
+        m < imageCount;
+        m++)
+    {
+        if(bulletOverlapsMask(gs, image + m, first, count, hitMask))
+        {
+            for(int word = MASK_WORDS(count) - 1;
+                word >= 0;
+                word--)
+            {
+                unsigned long long bits = hitMask[word];
+                while(bits)
+                {
+                    int j = findMostSignificantSetBit(bits);
+                    bits &= ~(1ULL << j);
+                    hitIndex[hitCount++] = first + word * 64 + j;
+                }
+            }
+        }
+    }
+    return(hitCount);
+}
+
+// Drops the candidates the swept test rejects, keeps the order
+static int
+keepSweptHits(GameState *gs, Bullet *bullet, int *hitIndex, int hitCount)
+{
+    int kept = hitCount;
+    if(gs->config.sweptCollision)
+    {
+        kept = 0;
+        for(int k = 0;
+            k < hitCount;
+            k++)
+        {
+            if(bulletHitsAsteroid(gs, bullet, hitIndex[k])) hitIndex[kept++] = hitIndex[k];
+        }
+    }
+    return(kept);
+}
+
+// Releases the bullet and takes out the asteroid it hit. A large one splits
+// in two small ones, which nothing can hit before next tick.
+static void
+resolveBulletHit(GameState *gs, int bulletIndex, int asteroidIndex)
+{
+    AsteroidPool *asteroids = &gs->asteroids;
+    releaseBullet(&gs->bullets, bulletIndex);
+    
+    bool split = asteroids->sizeClass[asteroidIndex] == ASTEROID_LARGE;
+    Vector2 splitPos = { asteroids->x[asteroidIndex], asteroids->y[asteroidIndex] };
+    Vector2 splitVelocity = { asteroids->vx[asteroidIndex], asteroids->vy[asteroidIndex] };
+    removeAsteroid(asteroids, asteroidIndex);
+    
+    // Spawn 2 small asteroids per large one
+    if(split)
+    {
+        spawnSmallAsteroid(gs, splitPos, splitVelocity);
+        spawnSmallAsteroid(gs, splitPos, splitVelocity);
+    }
+}
+
+// Squared distance from where the bullet came from to the asteroid, the
+// shortest way round when the world wraps
+static float
+bulletHitDistance(GameState *gs, Bullet *bullet, int asteroidIndex)
+{
+    float dx = gs->asteroids.x[asteroidIndex] - bullet->prevPos.x;
+    float dy = gs->asteroids.y[asteroidIndex] - bullet->prevPos.y;
+    if(gs->config.wrapWorld)
+    {
+        dx -= screenWidth * floorf(dx / screenWidth + 0.5f);
+        dy -= screenHeight * floorf(dy / screenHeight + 0.5f);
+    }
+    return(dx * dx + dy * dy);
+}
+
+// The queue grows in place at the top of the transient arena, nothing else
+// may be pushed there until detection is done. False when not even its
+// alignment fits.
+static bool
+beginHitEvents(HitEventQueue *queue, Arena *arena)
+{
+    queue->event = arena_push_array(arena, HitEvent, 0);
+    queue->count = 0;
+    return(queue->event != 0);
+}
+
+// One event per asteroid in hitIndex. False when the transient arena is full.
+static bool
+pushHitEvents(GameState *gs, HitEventQueue *queue, int bulletIndex, int *hitIndex, int hitCount)
+{
+    HitEvent *event = (HitEvent *)arena_alloc(gs->transient, hitCount * sizeof(HitEvent));
+    if(!event) return(false);
+    Assert(event == queue->event + queue->count);
+    
+    for(int k = 0;
+        k < hitCount;
+        k++)
+    {
+        event[k].bullet = bulletIndex;
+        event[k].asteroid = getAsteroidHandle(&gs->asteroids, hitIndex[k]);
+    }
+    queue->count += hitCount;
+    return(true);
+}
+
+// NOTE(trist007): applies the events a bullet at a time in slot order. The
+// events are stably sorted by bullet first, which costs nothing when they
+// came from one thread walking the bullets in order. A bullet takes out one
+// asteroid, the one nearest where it came from out of those still there,
+// the lower handle id on a tie. An asteroid an earlier bullet already
+// destroyed fails its handle lookup and the later bullet goes for its next
+// nearest, or flies on. Smalls split off this tick don't get tested until
+// the next one, like GameBatchUpdate.
+static void
+resolveHitEvents(GameState *gs, HitEventQueue *queue)
+{
+    AsteroidPool *asteroids = &gs->asteroids;
+    HitEvent *event = queue->event;
+    for(int i = 1;
+        i < queue->count;
+        i++)
+    {
+        HitEvent e = event[i];
+        int j = i - 1;
+        while(j >= 0 && event[j].bullet > e.bullet)
+        {
+            event[j + 1] = event[j];
+            j--;
+        }
+        event[j + 1] = e;
+    }
+    
+    int start = 0;
+    while(start < queue->count)
+    {
+        int bulletIndex = event[start].bullet;
+        Bullet *bullet = gs->bullets.bullet + bulletIndex;
+        int nearest = -1;
+        int nearestId = 0;
+        float nearestDistance = 0;
+        int end = start;
+        while(end < queue->count && event[end].bullet == bulletIndex)
+        {
+            int j = lookupAsteroid(asteroids, event[end].asteroid);
+            if(j >= 0)
+            {
+                float distance = bulletHitDistance(gs, bullet, j);
+                int id = event[end].asteroid.id;
+                if(nearest < 0 || distance < nearestDistance || (distance == nearestDistance && id < nearestId))
+                {
+                    nearest = j;
+                    nearestId = id;
+                    nearestDistance = distance;
+                }
+            }
+            end++;
+        }
+        
+        if(nearest >= 0) resolveBulletHit(gs, bulletIndex, nearest);
+        start = end;
+    }
+}
+
+// Every live bullet against every asteroid. hitMask holds a bit per asteroid
+// the pool can hold and hitIndex an entry per asteroid per image. False when
+// the events don't fit in the transient arena.
+static bool
+detectHitsBruteForce(GameState *gs, HitEventQueue *queue, unsigned long long *hitMask, int *hitIndex,
+                     float wrapReach)
+{
+    AsteroidPool *asteroids = &gs->asteroids;
+    BulletPool *bullets = &gs->bullets;
+    if(!beginHitEvents(queue, gs->transient)) return(false);
+    for(int word = 0;
+        word < bullets->maskWords;
+        word++)
+    {
+        unsigned long long bits = bullets->activeMask[word];
+        while(bits)
+        {
+            int i = word * 64 + findLeastSignificantSetBit(bits);
+            bits &= bits - 1;
+            
+            Bullet image[WRAP_MAX_IMAGES];
+            int imageCount = bulletImages(gs, bullets->bullet + i, wrapReach, image);
+            if(gs->timings) gs->timings->pairTests += asteroids->count * imageCount;
+            
+            int hitCount = bulletHitList(gs, image, imageCount, 0, asteroids->count, hitMask, hitIndex);
+            if(hitCount && !pushHitEvents(gs, queue, i, hitIndex, hitCount)) return(false);
+        }
+    }
+    return(true);
+}
+
+// Same hits as brute force, in the same order, only testing the asteroids in
+// the cells around each bullet. False when the grid or the events don't fit
+// in the transient arena.
+static bool
+detectHitsGrid(GameState *gs, HitEventQueue *queue, int *hitIndex, float wrapReach)
+{
+    AsteroidPool *asteroids = &gs->asteroids;
+    BulletPool *bullets = &gs->bullets;
+    
+    // Asteroids only get despawned this far out, past it they clamp to the
+    // edge cells
+    float margin = asteroids->classMargin[ASTEROID_LARGE];
+    if(asteroids->classMargin[ASTEROID_SMALL] > margin) margin = asteroids->classMargin[ASTEROID_SMALL];
+    
+    float r = gs->bulletRadius + sweptCandidatePad(gs);
+    AsteroidGrid grid;
+    if(!buildAsteroidGrid(&grid, gs->transient, asteroids, r,
+                          -margin, -margin, screenWidth + margin, screenHeight + margin))
+    {
+        return(false);
+    }
+    
+    if(!beginHitEvents(queue, gs->transient)) return(false);
+    for(int word = 0;
+        word < bullets->maskWords;
+        word++)
+    {
+        unsigned long long bits = bullets->activeMask[word];
+        while(bits)
+        {
+            int i = word * 64 + findLeastSignificantSetBit(bits);
+            bits &= bits - 1;
+            
+            Bullet image[WRAP_MAX_IMAGES];
+            int imageCount = bulletImages(gs, bullets->bullet + i, wrapReach, image);
+            int hitCount = 0;
+            for(int m = 0;
+                m < imageCount;
+                m++)
+            {
+                Vector2 center = bulletCandidateCenter(gs, image + m);
+                int imageHits = queryAsteroidGrid(&grid, center.x, center.y, r, hitIndex + hitCount);
+                hitCount += keepSweptHits(gs, image + m, hitIndex + hitCount, imageHits);
+            }
+            if(hitCount && !pushHitEvents(gs, queue, i, hitIndex, hitCount)) return(false);
+        }
+    }
+    
+    if(gs->timings) gs->timings->pairTests += grid.pairTests;
+    return(true);
+}
+
+// Moves each out of place key left until it fits, returns how many places
+// things moved. Close to linear on nearly sorted input.
+static long long
+insertionSortByKey(float *key, int *value, int count)
+{
+    long long shifts = 0;
+    for(int i = 1;
+        i < count;
+        i++)
+    {
+        float k = key[i];
+        int v = value[i];
+        int j = i - 1;
+        while(j >= 0 && key[j] > k)
+        {
+            key[j + 1] = key[j];
+            value[j + 1] = value[j];
+            j--;
+        }
+        key[j + 1] = k;
+        value[j + 1] = v;
+        shifts += i - 1 - j;
+    }
+    return(shifts);
+}
+
+// Merges two sorted runs into out, a's entries first on equal keys
+static void
+mergeByKey(float *aKey, int *aValue, int aCount, float *bKey, int *bValue, int bCount, float *outKey, int *outValue)
+{
+    int a = 0;
+    int b = 0;
+    for(int i = 0;
+        i < aCount + bCount;
+        i++)
+    {
+        if(b == bCount || (a < aCount && aKey[a] <= bKey[b]))
+        {
+            outKey[i] = aKey[a];
+            outValue[i] = aValue[a++];
+        }
+        else
+        {
+            outKey[i] = bKey[b];
+            outValue[i] = bValue[b++];
+        }
+    }
+}
+
+// Bottom up merge sort for input with no order to it, temp holds count
+static void
+mergeSortByKey(float *key, int *value, int count, float *tempKey, int *tempValue)
+{
+    for(int width = 1;
+        width < count;
+        width *= 2)
+    {
+        for(int start = 0;
+            start < count;
+            start += 2 * width)
+        {
+            int middle = (start + width < count) ? start + width : count;
+            int end = (start + 2 * width < count) ? start + 2 * width : count;
+            mergeByKey(key + start, value + start, middle - start, key + middle, value + middle, end - middle,
+                       tempKey + start, tempValue + start);
+        }
+        memcpy(key, tempKey, count * sizeof(float));
+        memcpy(value, tempValue, count * sizeof(int));
+    }
+}
+
+// NOTE(trist007): sweep and prune along x. The pool keeps its asteroids'
+// order by left edge from the last tick, this tick the survivors get fresh
+// edges and an insertion sort, which barely has to move anything since
+// asteroids fly straight. Newcomers get sorted on their own and merged in.
+// Live bullets are sorted by left edge too, then one sweep with a window of
+// asteroids that can still reach the current bullet hands each bullet its
+// x-overlapping asteroids. Those pairs go through the circle test in bullet
+// slot order, so the hits match brute force. False when the scratch or the
+// events don't fit in the transient arena.
+static bool
+detectHitsSweep(GameState *gs, HitEventQueue *queue, int *hitIndex, float wrapReach)
+{
+    AsteroidPool *asteroids = &gs->asteroids;
+    BulletPool *bullets = &gs->bullets;
+    Arena *transient = gs->transient;
+    int count = asteroids->count;
+    float r = gs->bulletRadius + sweptCandidatePad(gs);
+    
+    // Every image of a bullet gets its own entry in the sweep, image m of
+    // slot i at i * imageSlots + m
+    int imageSlots = (wrapReach > 0) ? WRAP_MAX_IMAGES : 1;
+    int entries = bullets->capacity * imageSlots;
+    
+    unsigned char *seen = arena_push_array(transient, unsigned char, count);
+    float *key = arena_push_array(transient, float, count);
+    int *order = arena_push_array(transient, int, count);
+    float *newKey = arena_push_array(transient, float, count);
+    int *newIndex = arena_push_array(transient, int, count);
+    float *tempKey = arena_push_array(transient, float, count + entries);
+    int *tempValue = arena_push_array(transient, int, count + entries);
+    float *sortedX = arena_push_array(transient, float, count);
+    float *sortedY = arena_push_array(transient, float, count);
+    float *sortedRadius = arena_push_array(transient, float, count);
+    int *sortedIndex = arena_push_array(transient, int, count);
+    float *bulletKey = arena_push_array(transient, float, entries);
+    int *bulletSlot = arena_push_array(transient, int, entries);
+    int *pairStart = arena_push_array(transient, int, entries);
+    int *pairCount = arena_push_array(transient, int, entries);
+    Bullet *image = arena_push_array(transient, Bullet, entries);
+    int *imageCount = arena_push_array(transient, int, bullets->capacity);
+    if(!seen || !key || !order || !newKey || !newIndex || !tempKey || !tempValue || !sortedX || !sortedY || !sortedRadius ||
+       !sortedIndex || !bulletKey || !bulletSlot || !pairStart || !pairCount || !image || !imageCount)
+    {
+        return(false);
+    }
+    
+    // Survivors of the kept order with fresh edges, nearly sorted. Handles so
+    // a recycled id doesn't pass for a survivor at some random new spot.
+    memset(seen, 0, count);
+    int kept = 0;
+    for(int k = 0;
+        k < asteroids->sweepCount;
+        k++)
+    {
+        int i = lookupAsteroid(asteroids, asteroids->sweepOrder[k]);
+        if(i >= 0)
+        {
+            seen[i] = 1;
+            order[kept] = i;
+            key[kept] = asteroids->x[i] - asteroids->radius[i];
+            kept++;
+        }
+    }
+    long long shifts = insertionSortByKey(key, order, kept);
+    
+    int added = 0;
+    for(int i = 0;
+        i < count;
+        i++)
+    {
+        if(!seen[i])
+        {
+            newKey[added] = asteroids->x[i] - asteroids->radius[i];
+            newIndex[added] = i;
+            added++;
+        }
+    }
+    mergeSortByKey(newKey, newIndex, added, tempKey, tempValue);
+    mergeByKey(key, order, kept, newKey, newIndex, added, tempKey, tempValue);
+    memcpy(key, tempKey, count * sizeof(float));
+    
+    // Copies in sweep order so the window scans run through memory in order
+    float maxRadius = 0;
+    for(int k = 0;
+        k < count;
+        k++)
+    {
+        int i = tempValue[k];
+        sortedX[k] = asteroids->x[i];
+        sortedY[k] = asteroids->y[i];
+        sortedRadius[k] = asteroids->radius[i];
+        sortedIndex[k] = i;
+        asteroids->sweepOrder[k] = getAsteroidHandle(asteroids, i);
+        maxRadius = (sortedRadius[k] > maxRadius) ? sortedRadius[k] : maxRadius;
+    }
+    asteroids->sweepCount = count;
+    
+    int bulletCount = 0;
+    for(int word = 0;
+        word < bullets->maskWords;
+        word++)
+    {
+        unsigned long long bits = bullets->activeMask[word];
+        while(bits)
+        {
+            int i = word * 64 + findLeastSignificantSetBit(bits);
+            bits &= bits - 1;
+            imageCount[i] = bulletImages(gs, bullets->bullet + i, wrapReach, image + i * imageSlots);
+            for(int m = 0;
+                m < imageCount[i];
+                m++)
+            {
+                int e = i * imageSlots + m;
+                bulletKey[bulletCount] = bulletCandidateCenter(gs, image + e).x - r;
+                bulletSlot[bulletCount] = e;
+                bulletCount++;
+            }
+        }
+    }
+    mergeSortByKey(bulletKey, bulletSlot, bulletCount, tempKey, tempValue);
+    
+    // The sweep. An asteroid whose left edge is more than its widest
+    // possible span behind the bullet's can't reach it or anything after.
+    int *pairs = (int *)(transient->base + transient->used);
+    int pairTotal = 0;
+    int lo = 0;
+    int hi = 0;
+    for(int b = 0;
+        b < bulletCount;
+        b++)
+    {
+        float left = bulletKey[b];
+        float right = left + 2 * r;
+        while(lo < count && key[lo] < left - 2 * maxRadius) lo++;
+        while(hi < count && key[hi] <= right) hi++;
+        
+        int window = (hi > lo) ? hi - lo : 0;
+        int *out = (int *)arena_alloc(transient, window * sizeof(int));
+        if(window && !out) return(false);
+        
+        int emitted = 0;
+        for(int k = lo;
+            k < hi;
+            k++)
+        {
+            out[emitted] = k;
+            emitted += (key[k] + 2 * sortedRadius[k] >= left);
+        }
+        transient->used -= (window - emitted) * sizeof(int);
+        
+        pairStart[bulletSlot[b]] = pairTotal;
+        pairCount[bulletSlot[b]] = emitted;
+        pairTotal += emitted;
+    }
+    
+    if(!beginHitEvents(queue, transient)) return(false);
+    for(int word = 0;
+        word < bullets->maskWords;
+        word++)
+    {
+        unsigned long long bits = bullets->activeMask[word];
+        while(bits)
+        {
+            int i = word * 64 + findLeastSignificantSetBit(bits);
+            bits &= bits - 1;
+            
+            int hitCount = 0;
+            for(int m = 0;
+                m < imageCount[i];
+                m++)
+            {
+                int e = i * imageSlots + m;
+                Vector2 center = bulletCandidateCenter(gs, image + e);
+                int imageHits = 0;
+                int *pair = pairs + pairStart[e];
+                for(int p = 0;
+                    p < pairCount[e];
+                    p++)
+                {
+                    int k = pair[p];
+                    float dx = sortedX[k] - center.x;
+                    float dy = sortedY[k] - center.y;
+                    float reach = sortedRadius[k] + r;
+                    if((dx * dx + dy * dy) < reach * reach) hitIndex[hitCount + imageHits++] = sortedIndex[k];
+                }
+                hitCount += keepSweptHits(gs, image + e, hitIndex + hitCount, imageHits);
+            }
+            
+            if(hitCount)
+            {
+                insertionSortDescending(hitIndex, hitCount);
+                if(!pushHitEvents(gs, queue, i, hitIndex, hitCount)) return(false);
+            }
+        }
+    }
+    
+    if(gs->timings)
+    {
+        gs->timings->pairTests += pairTotal;
+        gs->timings->sortShifts += shifts;
+    }
+    return(true);
+}
+
+void
+GameUpdate(GameState *gs, GameInput *input, float dt)
+{
+    if(!gs->gameOver)
+    {
+        BEGIN_TIMED_BLOCK(gs, TIMED_BLOCK_SHIP);
+        
+        // Control ship with keyboard
+        gs->ship.prevRotation = gs->ship.rotation;
+        if(input->rotateRight) gs->ship.rotation += gs->ship.turnSpeed * dt;
+        if(input->rotateLeft) gs->ship.rotation -= gs->ship.turnSpeed * dt;
+        if(input->thrust)
+        {
+            gs->ship.velocity.x += sinf(gs->ship.rotation) * gs->ship.thrust * dt;
+            gs->ship.velocity.y -= cosf(gs->ship.rotation) * gs->ship.thrust * dt;
+        }
+        if(input->reverse)
+        {
+            gs->ship.velocity.x -= sinf(gs->ship.rotation) * gs->ship.thrust * dt;
+            gs->ship.velocity.y += cosf(gs->ship.rotation) * gs->ship.thrust * dt;
+        }
+        BulletPool *bullets = &gs->bullets;
+        if(input->fire)
+        {
+            int i = allocateBullet(bullets);
+            if(i >= 0)
+            {
+                bullets->bullet[i].pos = gs->ship.pos;
+                bullets->bullet[i].prevPos = gs->ship.pos;
+                bullets->bullet[i].velocity.x = sinf(gs->ship.rotation) * gs->bulletSpeed;
+                bullets->bullet[i].velocity.y = -cosf(gs->ship.rotation) * gs->bulletSpeed;
+                bullets->bullet[i].timeLeft = gs->bulletLifetime;
+            }
+        }
+        
+        // Adjust asteroid speed
+        gs->gameTimer += dt;
+        if(gs->gameTimer >= gs->speedIncreaseInterval)
+        {
+            gs->asteroidSpeedMultiplier += 0.5f;
+            gs->gameTimer = 0.0f;
+        }
+        
+        // Apply velocity and friction to shipPosition
+        gs->ship.prevPos = gs->ship.pos;
+        gs->ship.pos.x += gs->ship.velocity.x * dt;
+        gs->ship.pos.y += gs->ship.velocity.y * dt;
+        
+        float friction = powf(gs->ship.friction, dt);
+        gs->ship.velocity.x *= friction;
+        gs->ship.velocity.y *= friction;
+        
+        END_TIMED_BLOCK(gs, TIMED_BLOCK_SHIP);
+        BEGIN_TIMED_BLOCK(gs, TIMED_BLOCK_BULLETS);
+        
+        // Update active bullets. Releasing clears the bit in the pool, the
+        // word being walked is a copy.
+        for(int word = 0;
+            word < bullets->maskWords;
+            word++)
+        {
+            unsigned long long bits = bullets->activeMask[word];
+            while(bits)
+            {
+                int i = word * 64 + findLeastSignificantSetBit(bits);
+                bits &= bits - 1;
+                
+                Bullet *bullet = bullets->bullet + i;
+                bullet->prevPos = bullet->pos;
+                bullet->pos.x += bullet->velocity.x * dt;
+                bullet->pos.y += bullet->velocity.y * dt;
+                
+                if(gs->config.wrapWorld)
+                {
+                    wrapPoint(&bullet->pos, &bullet->prevPos);
+                    bullet->timeLeft -= dt;
+                    if(bullet->timeLeft <= 0) releaseBullet(bullets, i);
+                }
+                else if(bullet->pos.x < 0 || bullet->pos.x > screenWidth ||
+                        bullet->pos.y < 0 || bullet->pos.y > screenHeight)
+                {
+                    // Deactive if off screen
+                    releaseBullet(bullets, i);
+                }
+            }
+        }
+        
+        END_TIMED_BLOCK(gs, TIMED_BLOCK_BULLETS);
+        BEGIN_TIMED_BLOCK(gs, TIMED_BLOCK_SPAWN);
+        
+        gs->asteroidSpawnTimer += dt;
+        
+        AsteroidPool *asteroids = &gs->asteroids;
+        if(gs->asteroidSpawnTimer >= gs->asteroidSpawnInterval)
+        {
+            // Spawn a large asteroid, only one per interval
+            int i = addAsteroid(asteroids, ASTEROID_LARGE);
+            if(i >= 0)
+            {
+                // Get random angle and scale for asteroid
+                float angle = randomRange(&gs->random, 0, 360) * DEG2RAD;
+                float spawnRadius = screenRadius + spawnMargin;
+                
+                Vector2 pos = { screenWidth / 2.0f + cosf(angle) * spawnRadius,
+                    screenHeight / 2.0f + sinf(angle) * spawnRadius };
+                if(gs->config.wrapWorld)
+                {
+                    // There is no off screen, come in where that angle
+                    // meets the edge instead
+                    float c = fabsf(cosf(angle));
+                    float s = fabsf(sinf(angle));
+                    float t = (c * screenHeight > s * screenWidth) ? (screenWidth / 2.0f) / c : (screenHeight / 2.0f) / s;
+                    pos = { screenWidth / 2.0f + cosf(angle) * t, screenHeight / 2.0f + sinf(angle) * t };
+                    if(pos.x < 0) pos.x += screenWidth;
+                    if(pos.x >= screenWidth) pos.x -= screenWidth;
+                    if(pos.y < 0) pos.y += screenHeight;
+                    if(pos.y >= screenHeight) pos.y -= screenHeight;
+                }
+                Vector2 direction = Vector2Normalize(Vector2Subtract(gs->asteroidTarget, pos));
+                float speed = gs->asteroidSpeed * gs->asteroidSpeedMultiplier;
+                
+                asteroids->x[i] = asteroids->prevX[i] = pos.x;
+                asteroids->y[i] = asteroids->prevY[i] = pos.y;
+                asteroids->vx[i] = direction.x * speed;
+                asteroids->vy[i] = direction.y * speed;
+                asteroids->radius[i] = (float)randomRange(&gs->random, 20, 80);
+                
+                gs->asteroidSpawnTimer = 0.0f;
+            }
+        }
+        
+        END_TIMED_BLOCK(gs, TIMED_BLOCK_SPAWN);
+        
+        // Update spawned asteroids, de-spawn the ones that went off screen or
+        // wrap them around
+        BEGIN_TIMED_BLOCK(gs, TIMED_BLOCK_MOVE_ASTEROIDS);
+        moveAsteroids(asteroids->x, asteroids->y, asteroids->prevX, asteroids->prevY,
+                      asteroids->vx, asteroids->vy, asteroids->count, dt);
+        END_TIMED_BLOCK(gs, TIMED_BLOCK_MOVE_ASTEROIDS);
+        
+        BEGIN_TIMED_BLOCK(gs, TIMED_BLOCK_DESPAWN);
+        if(gs->config.wrapWorld)
+        {
+            wrapAsteroids(asteroids, (float)screenWidth, (float)screenHeight);
+        }
+        else
+        {
+            despawnAsteroids(asteroids, (float)screenWidth, (float)screenHeight);
+        }
+        END_TIMED_BLOCK(gs, TIMED_BLOCK_DESPAWN);
+        
+        BEGIN_TIMED_BLOCK(gs, TIMED_BLOCK_BULLET_COLLISION);
+        
+        // Check for bullet asteroid collisions. Detection only reads, the
+        // hits it finds get applied after. With no room for the hit list
+        // the check sits the tick out, the transient arena's failedAllocs
+        // has counted it.
+        unsigned long long *hitMask = arena_push_array(gs->transient, unsigned long long,
+                                                       MASK_WORDS(asteroids->capacity));
+        int *hitIndex = arena_push_array(gs->transient, int, asteroids->capacity * WRAP_MAX_IMAGES);
+        if(hitMask && hitIndex)
+        {
+            float wrapReach = bulletWrapReach(gs);
+            HitEventQueue hits;
+            TemporaryMemory detectMemory = beginTemporaryMemory(gs->transient);
+            bool detected = false;
+            if(gs->config.broadphase == BROADPHASE_GRID) detected = detectHitsGrid(gs, &hits, hitIndex, wrapReach);
+            if(gs->config.broadphase == BROADPHASE_SWEEP) detected = detectHitsSweep(gs, &hits, hitIndex, wrapReach);
+            if(!detected)
+            {
+                endTemporaryMemory(detectMemory);
+                detectMemory = beginTemporaryMemory(gs->transient);
+                detected = detectHitsBruteForce(gs, &hits, hitMask, hitIndex, wrapReach);
+            }
+            
+            // NOTE(trist007): when even brute force runs the scratch out, this
+            // tick's bullet hits get dropped rather than half applied. The
+            // transient arena's failedAllocs has counted it, the bullets get
+            // another go next tick.
+            if(detected) resolveHitEvents(gs, &hits);
+            endTemporaryMemory(detectMemory);
+        }
+        
+        END_TIMED_BLOCK(gs, TIMED_BLOCK_BULLET_COLLISION);
+        BEGIN_TIMED_BLOCK(gs, TIMED_BLOCK_SHIP_COLLISION);
+        
+        // Check for asteroid player collisions. The mask is a bit per
+        // asteroid and pushed first, it only goes missing when the scratch
+        // was full before the tick started.
+        if(!gs->gameOver && hitMask)
+        {
+            Ship *ship = &gs->ship;
+            Vector2 offset[WRAP_MAX_IMAGES];
+            int imageCount = 1;
+            offset[0] = { 0, 0 };
+            if(gs->config.wrapWorld)
+            {
+                wrapPoint(&ship->pos, &ship->prevPos);
+                imageCount = wrapImages(&gs->config, ship->pos, shipWrapReach(gs), offset);
+            }
+            
+            int shipHits = 0;
+            for(int m = 0;
+                m < imageCount;
+                m++)
+            {
+                Vector2 pos = Vector2Add(ship->pos, offset[m]);
+                Vector2 prevPos = Vector2Add(ship->prevPos, offset[m]);
+                if(gs->config.sweptCollision)
+                {
+                    shipHits += sweptOverlapAsteroidsMask(asteroids->x, asteroids->y, asteroids->prevX,
+                                                          asteroids->prevY, asteroids->radius, asteroids->count,
+                                                          prevPos.x, prevPos.y, pos.x, pos.y, ship->size, hitMask);
+                }
+                else
+                {
+                    shipHits += overlapAsteroidsMask(asteroids->x, asteroids->y, asteroids->radius, asteroids->count,
+                                                     pos.x, pos.y, ship->size, hitMask);
+                }
+            }
+            if(shipHits) gs->gameOver = true;
+        }
+        
+        // Check if player ship has gone offscreen only to wrap on the opposite end
+        // NOTE(trist007): if the ship moves very fast it can do multiple
+        // wraps so you can use the crossedOver bool
+        if(!gs->config.wrapWorld &&
+           (gs->ship.pos.x < 0 || gs->ship.pos.x > screenWidth ||
+            gs->ship.pos.y < 0 || gs->ship.pos.y > screenHeight))
+        {
+            // Wrap horizontally
+            if(gs->ship.pos.x < 0) gs->ship.pos.x = screenWidth;
+            if(gs->ship.pos.x > screenWidth) gs->ship.pos.x = 0;
+            
+            // Wrap veritcally
+            if(gs->ship.pos.y < 0) gs->ship.pos.y = screenHeight;
+            if(gs->ship.pos.y > screenHeight) gs->ship.pos.y = 0;
+            
+            // Teleported, don't interpolate across the screen
+            gs->ship.prevPos = gs->ship.pos;
+        }
+        
+        END_TIMED_BLOCK(gs, TIMED_BLOCK_SHIP_COLLISION);
+    }
+    
+    // Nothing in the scratch arena outlives the tick
+    arena_reset(gs->transient);
+}
+
+GameConfig
+defaultGameConfig(void)
+{
+    GameConfig result;
+    result.bulletCapacity = DEFAULT_BULLET_CAPACITY;
+    result.largeAsteroidCapacity = DEFAULT_LARGE_ASTEROID_CAPACITY;
+    result.smallAsteroidCapacity = DEFAULT_SMALL_ASTEROID_CAPACITY;
+    result.broadphase = BROADPHASE_BRUTE_FORCE;
+    result.sweptCollision = false;
+    result.wrapWorld = false;
+    return(result);
+}
+
+// Upper bound on what pushGameState takes from an arena, alignment included
+size_t
+gameStateSize(GameConfig *config)
+{
+    size_t slots = ASTEROID_POOL_SLOTS(config->largeAsteroidCapacity + config->smallAsteroidCapacity);
+    size_t result = sizeof(GameState) +
+        config->bulletCapacity * (sizeof(Bullet) + sizeof(int)) + MASK_WORDS(config->bulletCapacity) * 8 + 3 * 64 +
+        slots * (7 * sizeof(float) + 4 * sizeof(int) + sizeof(AsteroidHandle)) + 12 * 64;
+    return(result);
+}
+
+// The GameState and its pools, uninitialized until initializeGameState
+GameState *
+pushGameState(Arena *arena, GameConfig *config)
+{
+    GameConfig copy = *config;
+    GameState *gs = arena_push(arena, GameState);
+    if(gs)
+    {
+        *gs = {};
+        gs->config = copy;
+        if(!pushBulletPool(arena, &gs->bullets, copy.bulletCapacity) ||
+           !pushAsteroidPool(arena, &gs->asteroids, copy.largeAsteroidCapacity + copy.smallAsteroidCapacity))
+        {
+            gs = 0;
+        }
+    }
+    return(gs);
+}
+
+// Starts the arena over with a single game in it. Restarts can pass
+// &gs->config, it is copied before the arena gets reused.
+GameState *
+initializeGame(Arena *arena, Arena *transient, unsigned long long seed, GameConfig *config)
+{
+    GameConfig copy = *config;
+    arena_reset(arena);
+    GameState *gs = pushGameState(arena, &copy);
+    if(gs) initializeGameState(gs, transient, seed);
+    
+    return(gs);
+}
+
+// NOTE(trist007): restart with randomNext(&gs->random) as the seed to keep a
+// whole run of games reproducible from the first one
+void
+initializeGameState(GameState *gs, Arena *transient, unsigned long long seed)
+{
+    gs->gameOver = false;
+    gs->transient = transient;
+    gs->random = seedRandomSeries(seed);
+    gs->speedIncreaseInterval = 10.0f;
+    gs->asteroidSpawnInterval = 1.0f;
+    
+    // NOTE(trist007): timers were never cleared, the arena memory just
+    // happened to be zero on the first run
+    gs->gameTimer = 0.0f;
+    gs->asteroidSpawnTimer = 0.0f;
+    
+    gs->asteroidSpeed = 120.0f;
+    gs->asteroidTarget = { screenWidth / 2.0f, screenHeight / 2.0f };
+    gs->asteroidSpeedMultiplier = 1.0f;
+    gs->bulletRadius = 3.0f;
+    gs->bulletSpeed = 600.0f;
+    gs->bulletLifetime = 1.0f;
+    
+    // Initialize ship
+    gs->ship.pos = { (float)screenWidth / 2, (float)screenHeight / 2 };
+    gs->ship.prevPos = gs->ship.pos;
+    gs->ship.velocity = {};
+    gs->ship.rotation = 0.0f;
+    gs->ship.prevRotation = 0.0f;
+    gs->ship.turnSpeed = 3.0f;
+    gs->ship.thrust = 360.0f;
+    gs->ship.friction = 0.547f; // velocity kept per second, 1.0 for no friction, lower = more friction
+    gs->ship.color = { 0, 82, 172, 255 }; // DARKBLUE
+    gs->ship.size = 15.0f;
+    
+    resetBulletPool(&gs->bullets);
+    
+    // Initialize asteroids, padding included so the SIMD loops never read
+    // garbage past the live range
+    AsteroidPool *asteroids = &gs->asteroids;
+    asteroids->count = 0;
+    asteroids->classLimit[ASTEROID_LARGE] = gs->config.largeAsteroidCapacity;
+    asteroids->classLimit[ASTEROID_SMALL] = gs->config.smallAsteroidCapacity;
+    asteroids->classStats[ASTEROID_LARGE] = {};
+    asteroids->classStats[ASTEROID_SMALL] = {};
+    asteroids->classMargin[ASTEROID_LARGE] = 200.0f;
+    asteroids->classMargin[ASTEROID_SMALL] = 175.0f;
+    if(asteroids->capacity)
+    {
+        size_t slots = ASTEROID_POOL_SLOTS(asteroids->capacity);
+        memset(asteroids->x, 0, slots * sizeof(float));
+        memset(asteroids->y, 0, slots * sizeof(float));
+        memset(asteroids->prevX, 0, slots * sizeof(float));
+        memset(asteroids->prevY, 0, slots * sizeof(float));
+        memset(asteroids->vx, 0, slots * sizeof(float));
+        memset(asteroids->vy, 0, slots * sizeof(float));
+        memset(asteroids->radius, 0, slots * sizeof(float));
+        memset(asteroids->sizeClass, 0, slots * sizeof(int));
+        resetAsteroidIds(asteroids);
+    }
+}
+
+void
+spawnSmallAsteroid(GameState *gs, Vector2 asteroidPos, Vector2 asteroidVelocity)
+{
+    AsteroidPool *asteroids = &gs->asteroids;
+    int i = addAsteroid(asteroids, ASTEROID_SMALL);
+    if(i >= 0)
+    {
+        asteroids->x[i] = asteroids->prevX[i] = asteroidPos.x;
+        asteroids->y[i] = asteroids->prevY[i] = asteroidPos.y;
+        asteroids->radius[i] = (float)randomRange(&gs->random, 5, 10);
+        
+        // Parent direction is its normalized velocity, add some spread
+        Vector2 asteroidDirection = Vector2Normalize(asteroidVelocity);
+        float spread = randomRange(&gs->random, -40, 40) * DEG2RAD;
+        
+        float dx = asteroidDirection.x * cosf(spread) - asteroidDirection.y * sinf(spread);
+        float dy = asteroidDirection.x * sinf(spread) + asteroidDirection.y * cosf(spread);
+        
+        asteroids->vx[i] = dx * gs->asteroidSpeed;
+        asteroids->vy[i] = dy * gs->asteroidSpeed;
+    }
+}
+
+bool
+pushBulletPool(Arena *arena, BulletPool *pool, int capacity)
+{
+    *pool = {};
+    pool->capacity = capacity;
+    pool->maskWords = MASK_WORDS(capacity);
+    pool->bullet = arena_push_array(arena, Bullet, capacity);
+    pool->activeMask = arena_push_array(arena, unsigned long long, pool->maskWords);
+    pool->freeIndex = arena_push_array(arena, int, capacity);
+    return(pool->bullet && pool->activeMask && pool->freeIndex);
+}
+
+// Every slot free, stacked so slot 0 gets fired first
+void
+resetBulletPool(BulletPool *pool)
+{
+    for(int i = 0;
+        i < pool->capacity;
+        i++)
+    {
+        pool->bullet[i].active = false;
+        pool->bullet[i].generation = 1;
+        pool->freeIndex[i] = pool->capacity - 1 - i;
+    }
+    for(int word = 0;
+        word < pool->maskWords;
+        word++)
+    {
+        pool->activeMask[word] = 0;
+    }
+    pool->freeCount = pool->capacity;
+    pool->stats = {};
+}
+
+// Pops a free bullet slot and marks it active, -1 when they are all flying
+int
+allocateBullet(BulletPool *pool)
+{
+    int result = -1;
+    PoolStats *stats = &pool->stats;
+    if(pool->freeCount > 0)
+    {
+        result = pool->freeIndex[--pool->freeCount];
+        pool->bullet[result].active = true;
+        pool->activeMask[result / 64] |= 1ULL << (result % 64);
+        
+        stats->spawns++;
+        if(++stats->live > stats->peak) stats->peak = stats->live;
+    }
+    else
+    {
+        stats->failedSpawns++;
+    }
+    return(result);
+}
+
+void
+releaseBullet(BulletPool *pool, int index)
+{
+    Assert(pool->bullet[index].active && pool->freeCount < pool->capacity);
+    pool->bullet[index].active = false;
+    pool->activeMask[index / 64] &= ~(1ULL << (index % 64));
+    if(++pool->bullet[index].generation == 0) pool->bullet[index].generation = 1;
+    pool->freeIndex[pool->freeCount++] = index;
+    pool->stats.live--;
+}
+
+BulletHandle
+getBulletHandle(BulletPool *pool, int index)
+{
+    Assert(pool->bullet[index].active);
+    BulletHandle result;
+    result.index = index;
+    result.generation = pool->bullet[index].generation;
+    return(result);
+}
+
+// The bullet's slot, or -1 once it has been released
+int
+lookupBullet(BulletPool *pool, BulletHandle handle)
+{
+    int result = -1;
+    if(handle.index >= 0 && handle.index < pool->capacity)
+    {
+        Bullet *bullet = pool->bullet + handle.index;
+        if(bullet->active && bullet->generation == handle.generation) result = handle.index;
+    }
+    return(result);
+}
+
+// Arrays come out padded to a whole SIMD group
+bool
+pushAsteroidPool(Arena *arena, AsteroidPool *pool, int capacity)
+{
+    int padded = ASTEROID_POOL_SLOTS(capacity);
+    *pool = {};
+    pool->capacity = capacity;
+    pool->classLimit[ASTEROID_LARGE] = capacity;
+    pool->classLimit[ASTEROID_SMALL] = capacity;
+    pool->x = arena_push_array(arena, float, padded);
+    pool->y = arena_push_array(arena, float, padded);
+    pool->prevX = arena_push_array(arena, float, padded);
+    pool->prevY = arena_push_array(arena, float, padded);
+    pool->vx = arena_push_array(arena, float, padded);
+    pool->vy = arena_push_array(arena, float, padded);
+    pool->radius = arena_push_array(arena, float, padded);
+    pool->sizeClass = arena_push_array(arena, int, padded);
+    pool->id = arena_push_array(arena, int, padded);
+    pool->denseIndex = arena_push_array(arena, int, padded);
+    pool->generation = arena_push_array(arena, unsigned int, padded);
+    pool->sweepOrder = arena_push_array(arena, AsteroidHandle, padded);
+    
+    bool result = (pool->x && pool->y && pool->prevX && pool->prevY && pool->vx && pool->vy && pool->radius &&
+                   pool->sizeClass && pool->id && pool->denseIndex && pool->generation && pool->sweepOrder);
+    if(result) resetAsteroidIds(pool);
+    return(result);
+}
+
+// Every id free and on generation 1. Handles taken before this (from a game
+// that got restarted) must not be used again.
+void
+resetAsteroidIds(AsteroidPool *pool)
+{
+    for(int i = 0;
+        i < pool->capacity;
+        i++)
+    {
+        pool->id[i] = i;
+        pool->denseIndex[i] = i;
+        pool->generation[i] = 1;
+    }
+    pool->sweepCount = 0;
+}
+
+// Appends to the live range, -1 when the pool or the class is full. The
+// caller fills in everything but the class.
+// NOTE(trist007): the large spawner retries every tick while its class is
+// full, each retry counts as a failed spawn
+int
+addAsteroid(AsteroidPool *pool, int sizeClass)
+{
+    int result = -1;
+    PoolStats *stats = pool->classStats + sizeClass;
+    if(pool->count < pool->capacity && stats->live < pool->classLimit[sizeClass])
+    {
+        result = pool->count++;
+        pool->sizeClass[result] = sizeClass;
+        pool->denseIndex[pool->id[result]] = result;
+        
+        stats->spawns++;
+        if(++stats->live > stats->peak) stats->peak = stats->live;
+    }
+    else
+    {
+        stats->failedSpawns++;
+    }
+    return(result);
+}
+
+// Swap remove, the last live asteroid moves into index
+void
+removeAsteroid(AsteroidPool *pool, int index)
+{
+    Assert(index >= 0 && index < pool->count);
+    pool->classStats[pool->sizeClass[index]].live--;
+    
+    // The dead id goes to the front of the free ids, old handles to it stop
+    // resolving
+    int last = --pool->count;
+    int deadId = pool->id[index];
+    if(++pool->generation[deadId] == 0) pool->generation[deadId] = 1;
+    
+    pool->x[index] = pool->x[last];
+    pool->y[index] = pool->y[last];
+    pool->prevX[index] = pool->prevX[last];
+    pool->prevY[index] = pool->prevY[last];
+    pool->vx[index] = pool->vx[last];
+    pool->vy[index] = pool->vy[last];
+    pool->radius[index] = pool->radius[last];
+    pool->sizeClass[index] = pool->sizeClass[last];
+    pool->id[index] = pool->id[last];
+    pool->id[last] = deadId;
+    pool->denseIndex[pool->id[index]] = index;
+}
+
+AsteroidHandle
+getAsteroidHandle(AsteroidPool *pool, int index)
+{
+    Assert(index >= 0 && index < pool->count);
+    AsteroidHandle result;
+    result.id = pool->id[index];
+    result.generation = pool->generation[result.id];
+    return(result);
+}
+
+// Where the asteroid is in the live range now, or -1 once it is gone
+int
+lookupAsteroid(AsteroidPool *pool, AsteroidHandle handle)
+{
+    int result = -1;
+    if(handle.id >= 0 && handle.id < pool->capacity && pool->generation[handle.id] == handle.generation)
+    {
+        result = pool->denseIndex[handle.id];
+    }
+    return(result);
+}
+
+// Removes every asteroid that got further than its class margin off screen,
+// returns how many went. Most ticks nothing leaves, a branch free count
+// finds that out before the removal pass.
+int
+despawnAsteroids(AsteroidPool *pool, float width, float height)
+{
+    float largeMargin = pool->classMargin[ASTEROID_LARGE];
+    float smallMargin = pool->classMargin[ASTEROID_SMALL];
+    float *x = pool->x;
+    float *y = pool->y;
+    int *sizeClass = pool->sizeClass;
+    
+    int outside = 0;
+    for(int i = 0;
+        i < pool->count;
+        i++)
+    {
+        float margin = (sizeClass[i] == ASTEROID_LARGE) ? largeMargin : smallMargin;
+        outside += (x[i] < -margin) | (x[i] > width + margin) | (y[i] < -margin) | (y[i] > height + margin);
+    }
+    
+    if(outside)
+    {
+        // Back to front in SIMD sized chunks, skipping chunks with nothing
+        // outside. Whatever gets swapped in comes from further back and has
+        // already been checked.
+        for(int chunk = (pool->count - 1) & ~(ASTEROID_SIMD_WIDTH - 1);
+            chunk >= 0;
+            chunk -= ASTEROID_SIMD_WIDTH)
+        {
+            int end = chunk + ASTEROID_SIMD_WIDTH;
+            if(end > pool->count) end = pool->count;
+            
+            int any = 0;
+            for(int i = chunk;
+                i < end;
+                i++)
+            {
+                float margin = (sizeClass[i] == ASTEROID_LARGE) ? largeMargin : smallMargin;
+                any |= (x[i] < -margin) | (x[i] > width + margin) | (y[i] < -margin) | (y[i] > height + margin);
+            }
+            
+            if(any)
+            {
+                for(int i = end - 1;
+                    i >= chunk;
+                    i--)
+                {
+                    float margin = (sizeClass[i] == ASTEROID_LARGE) ? largeMargin : smallMargin;
+                    if((x[i] < -margin) | (x[i] > width + margin) | (y[i] < -margin) | (y[i] > height + margin))
+                    {
+                        removeAsteroid(pool, i);
+                    }
+                }
+            }
+        }
+    }
+    return(outside);
+}
+
+// The wrapping world's version of despawning: anything whose center left
+// [0, width) x [0, height) comes back in on the other side, its previous
+// position shifted along so swept tests see a short step and not a jump
+// across the screen. Returns how many crossed a seam.
+int
+wrapAsteroids(AsteroidPool *pool, float width, float height)
+{
+    float *x = pool->x;
+    float *y = pool->y;
+    float *prevX = pool->prevX;
+    float *prevY = pool->prevY;
+    
+    int crossed = 0;
+    for(int i = 0;
+        i < pool->count;
+        i++)
+    {
+        float shiftX = (float)(x[i] < 0) * width - (float)(x[i] >= width) * width;
+        float shiftY = (float)(y[i] < 0) * height - (float)(y[i] >= height) * height;
+        x[i] += shiftX;
+        prevX[i] += shiftX;
+        y[i] += shiftY;
+        prevY[i] += shiftY;
+        crossed += (shiftX != 0) | (shiftY != 0);
+    }
+    return(crossed);
+}
+
+// Offsets to test a query circle at so it catches everything within reach of
+// pos across the seams of the wrapping world. offset[0] is always no shift,
+// then one per seam within reach and the diagonal when both are. Returns how
+// many, 1 when the world doesn't wrap. Nothing is more than half the world
+// away by minimum image and the shift towards the nearer seam brings in
+// everything on the far side, so the reach stops at half the world, which a
+// fast swept game gets to. Its query circle can then catch the same thing
+// through two images.
+int
+wrapImages(GameConfig *config, Vector2 pos, float reach, Vector2 *offset)
+{
+    int count = 0;
+    offset[count++] = { 0, 0 };
+    if(config->wrapWorld)
+    {
+        float reachX = (reach < 0.5f * screenWidth) ? reach : 0.5f * screenWidth;
+        float reachY = (reach < 0.5f * screenHeight) ? reach : 0.5f * screenHeight;
+        float shiftX = 0;
+        float shiftY = 0;
+        if(pos.x < reachX) shiftX = (float)screenWidth;
+        if(pos.x > screenWidth - reachX) shiftX = -(float)screenWidth;
+        if(pos.y < reachY) shiftY = (float)screenHeight;
+        if(pos.y > screenHeight - reachY) shiftY = -(float)screenHeight;
+        
+        if(shiftX != 0) offset[count++] = { shiftX, 0 };
+        if(shiftY != 0) offset[count++] = { 0, shiftY };
+        if(shiftX != 0 && shiftY != 0) offset[count++] = { shiftX, shiftY };
+    }
+    return(count);
+}
+
+// NOTE(trist007): SoA kernels over the live range, shared with the layout
+// benchmark. No branches, __restrict so they vectorise without alias checks.
+void
+moveAsteroids(float * __restrict x, float * __restrict y, float * __restrict prevX, float * __restrict prevY,
+              float * __restrict vx, float * __restrict vy, int count, float dt)
+{
+    for(int i = 0;
+        i < count;
+        i++)
+    {
+        prevX[i] = x[i];
+        prevY[i] = y[i];
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+    }
+}
+
+// Flags the asteroids overlapping a circle in hit and returns how many there
+// were. Squared distances, no sqrtf.
+int
+overlapAsteroids(float * __restrict x, float * __restrict y, float * __restrict radius, int count,
+                 float px, float py, float r, int * __restrict hit)
+{
+    int hitCount = 0;
+    for(int i = 0;
+        i < count;
+        i++)
+    {
+        float dx = x[i] - px;
+        float dy = y[i] - py;
+        float reach = radius[i] + r;
+        hit[i] = (dx * dx + dy * dy) < reach * reach;
+        hitCount += hit[i];
+    }
+    return(hitCount);
+}
+
+// NOTE(trist007): same test as overlapAsteroids, NARROWPHASE_LANES circles
+// per compare. Bit i of hitMask is set when asteroid i overlaps, the whole
+// MASK_WORDS(count) words are written so callers don't clear them first.
+// Unaligned loads, a range can start anywhere in the pool. Full words pack
+// the compare results down to bytes so there's one movemask per 16 or 32
+// circles, the partial word at the end goes a group and then one at a time.
+// Slots past count are never read.
+#if NARROWPHASE_LANES == 8
+static inline __m256i
+overlapGroup(float *x, float *y, float *radius, __m256 centerX, __m256 centerY, __m256 circleRadius)
+{
+    __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x), centerX);
+    __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y), centerY);
+    __m256 reach = _mm256_add_ps(_mm256_loadu_ps(radius), circleRadius);
+    __m256 inside = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                  _mm256_mul_ps(reach, reach), _CMP_LT_OQ);
+    return(_mm256_castps_si256(inside));
+}
+#elif NARROWPHASE_LANES == 4
+static inline __m128i
+overlapGroup(float *x, float *y, float *radius, __m128 centerX, __m128 centerY, __m128 circleRadius)
+{
+    __m128 dx = _mm_sub_ps(_mm_loadu_ps(x), centerX);
+    __m128 dy = _mm_sub_ps(_mm_loadu_ps(y), centerY);
+    __m128 reach = _mm_add_ps(_mm_loadu_ps(radius), circleRadius);
+    __m128 inside = _mm_cmplt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(reach, reach));
+    return(_mm_castps_si128(inside));
+}
+#endif
+
+int
+overlapAsteroidsMask(float *x, float *y, float *radius, int count, float px, float py, float r,
+                     unsigned long long *hitMask)
+{
+#if NARROWPHASE_LANES == 8
+    __m256 centerX = _mm256_set1_ps(px);
+    __m256 centerY = _mm256_set1_ps(py);
+    __m256 circleRadius = _mm256_set1_ps(r);
+    // packs works inside each 128 bit half, this puts the dwords back in order
+    __m256i packOrder = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+#elif NARROWPHASE_LANES == 4
+    __m128 centerX = _mm_set1_ps(px);
+    __m128 centerY = _mm_set1_ps(py);
+    __m128 circleRadius = _mm_set1_ps(r);
+#endif
+    
+    int hitCount = 0;
+    int fullWords = count / 64;
+    for(int word = 0;
+        word < fullWords;
+        word++)
+    {
+        unsigned long long bits = 0;
+        for(int group = 0;
+            group < 64;
+            group += 4 * NARROWPHASE_LANES)
+        {
+            int i = word * 64 + group;
+#if NARROWPHASE_LANES == 8
+            __m256i a = overlapGroup(x + i, y + i, radius + i, centerX, centerY, circleRadius);
+            __m256i b = overlapGroup(x + i + 8, y + i + 8, radius + i + 8, centerX, centerY, circleRadius);
+            __m256i c = overlapGroup(x + i + 16, y + i + 16, radius + i + 16, centerX, centerY, circleRadius);
+            __m256i d = overlapGroup(x + i + 24, y + i + 24, radius + i + 24, centerX, centerY, circleRadius);
+            __m256i low = _mm256_packs_epi32(a, b);
+            __m256i high = _mm256_packs_epi32(c, d);
+            __m256i packed = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(low, high), packOrder);
+            bits |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(packed) << group;
+#elif NARROWPHASE_LANES == 4
+            __m128i a = overlapGroup(x + i, y + i, radius + i, centerX, centerY, circleRadius);
+            __m128i b = overlapGroup(x + i + 4, y + i + 4, radius + i + 4, centerX, centerY, circleRadius);
+            __m128i c = overlapGroup(x + i + 8, y + i + 8, radius + i + 8, centerX, centerY, circleRadius);
+            __m128i d = overlapGroup(x + i + 12, y + i + 12, radius + i + 12, centerX, centerY, circleRadius);
+            __m128i low = _mm_packs_epi32(a, b);
+            __m128i high = _mm_packs_epi32(c, d);
+            bits |= (unsigned long long)_mm_movemask_epi8(_mm_packs_epi16(low, high)) << group;
+#else
+            for(int k = i;
+                k < i + 4;
+                k++)
+            {
+                float dx = x[k] - px;
+                float dy = y[k] - py;
+                float reach = radius[k] + r;
+                bits |= (unsigned long long)((dx * dx + dy * dy) < reach * reach) << (k - word * 64);
+            }
+#endif
+        }
+        hitMask[word] = bits;
+        hitCount += countSetBits(bits);
+    }
+    
+    if(count > fullWords * 64)
+    {
+        int first = fullWords * 64;
+        unsigned long long bits = 0;
+        int i = first;
+#if NARROWPHASE_LANES == 8
+        for(;
+            i + 8 <= count;
+            i += 8)
+        {
+            __m256i inside = overlapGroup(x + i, y + i, radius + i, centerX, centerY, circleRadius);
+            bits |= (unsigned long long)_mm256_movemask_ps(_mm256_castsi256_ps(inside)) << (i - first);
+        }
+#elif NARROWPHASE_LANES == 4
+        for(;
+            i + 4 <= count;
+            i += 4)
+        {
+            __m128i inside = overlapGroup(x + i, y + i, radius + i, centerX, centerY, circleRadius);
+            bits |= (unsigned long long)_mm_movemask_ps(_mm_castsi128_ps(inside)) << (i - first);
+        }
+#endif
+        for(;
+            i < count;
+            i++)
+        {
+            float dx = x[i] - px;
+            float dy = y[i] - py;
+            float reach = radius[i] + r;
+            bits |= (unsigned long long)((dx * dx + dy * dy) < reach * reach) << (i - first);
+        }
+        hitMask[fullWords] = bits;
+        hitCount += countSetBits(bits);
+    }
+    return(hitCount);
+}
+
+// NOTE(trist007): sweptCircleHit for a moving circle against count moving
+// asteroids, NARROWPHASE_LANES at a time, bits in hitMask like
+// overlapAsteroidsMask. The circle goes from (fromX, fromY) to (toX, toY)
+// over the tick, the asteroids from prev to where they are now. About three
+// times the work of the plain test per pair, so no byte packing, a movemask
+// per group is lost in the noise.
+int
+sweptOverlapAsteroidsMask(float *x, float *y, float *prevX, float *prevY, float *radius, int count,
+                          float fromX, float fromY, float toX, float toY, float r, unsigned long long *hitMask)
+{
+    float moveX = toX - fromX;
+    float moveY = toY - fromY;
+#if NARROWPHASE_LANES == 8
+    __m256 circleFromX = _mm256_set1_ps(fromX);
+    __m256 circleFromY = _mm256_set1_ps(fromY);
+    __m256 circleMoveX = _mm256_set1_ps(moveX);
+    __m256 circleMoveY = _mm256_set1_ps(moveY);
+    __m256 circleRadius = _mm256_set1_ps(r);
+    __m256 zero = _mm256_setzero_ps();
+#elif NARROWPHASE_LANES == 4
+    __m128 circleFromX = _mm_set1_ps(fromX);
+    __m128 circleFromY = _mm_set1_ps(fromY);
+    __m128 circleMoveX = _mm_set1_ps(moveX);
+    __m128 circleMoveY = _mm_set1_ps(moveY);
+    __m128 circleRadius = _mm_set1_ps(r);
+    __m128 zero = _mm_setzero_ps();
+#endif
+    
+    int hitCount = 0;
+    for(int word = 0;
+        word < MASK_WORDS(count);
+        word++)
+    {
+        int first = word * 64;
+        int end = (first + 64 < count) ? first + 64 : count;
+        unsigned long long bits = 0;
+        int i = first;
+#if NARROWPHASE_LANES == 8
+        for(;
+            i + 8 <= end;
+            i += 8)
+        {
+            __m256 startX = _mm256_sub_ps(circleFromX, _mm256_loadu_ps(prevX + i));
+            __m256 startY = _mm256_sub_ps(circleFromY, _mm256_loadu_ps(prevY + i));
+            __m256 deltaX = _mm256_sub_ps(circleMoveX, _mm256_sub_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(prevX + i)));
+            __m256 deltaY = _mm256_sub_ps(circleMoveY, _mm256_sub_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(prevY + i)));
+            __m256 endX = _mm256_add_ps(startX, deltaX);
+            __m256 endY = _mm256_add_ps(startY, deltaY);
+            __m256 reach = _mm256_add_ps(_mm256_loadu_ps(radius + i), circleRadius);
+            __m256 reach2 = _mm256_mul_ps(reach, reach);
+            __m256 startDistance = _mm256_add_ps(_mm256_mul_ps(startX, startX), _mm256_mul_ps(startY, startY));
+            __m256 endDistance = _mm256_add_ps(_mm256_mul_ps(endX, endX), _mm256_mul_ps(endY, endY));
+            __m256 along = _mm256_add_ps(_mm256_mul_ps(startX, deltaX), _mm256_mul_ps(startY, deltaY));
+            __m256 length = _mm256_add_ps(_mm256_mul_ps(deltaX, deltaX), _mm256_mul_ps(deltaY, deltaY));
+            __m256 between = _mm256_and_ps(_mm256_cmp_ps(along, zero, _CMP_LT_OQ),
+                                           _mm256_cmp_ps(along, _mm256_sub_ps(zero, length), _CMP_GT_OQ));
+            __m256 closest = _mm256_cmp_ps(_mm256_mul_ps(_mm256_sub_ps(startDistance, reach2), length),
+                                           _mm256_mul_ps(along, along), _CMP_LT_OQ);
+            __m256 inside = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(startDistance, reach2, _CMP_LT_OQ),
+                                                      _mm256_cmp_ps(endDistance, reach2, _CMP_LT_OQ)),
+                                         _mm256_and_ps(between, closest));
+            bits |= (unsigned long long)_mm256_movemask_ps(inside) << (i - first);
+        }
+#elif NARROWPHASE_LANES == 4
+        for(;
+            i + 4 <= end;
+            i += 4)
+        {
+            __m128 startX = _mm_sub_ps(circleFromX, _mm_loadu_ps(prevX + i));
+            __m128 startY = _mm_sub_ps(circleFromY, _mm_loadu_ps(prevY + i));
+            __m128 deltaX = _mm_sub_ps(circleMoveX, _mm_sub_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(prevX + i)));
+            __m128 deltaY = _mm_sub_ps(circleMoveY, _mm_sub_ps(_mm_loadu_ps(y + i), _mm_loadu_ps(prevY + i)));
+            __m128 endX = _mm_add_ps(startX, deltaX);
+            __m128 endY = _mm_add_ps(startY, deltaY);
+            __m128 reach = _mm_add_ps(_mm_loadu_ps(radius + i), circleRadius);
+            __m128 reach2 = _mm_mul_ps(reach, reach);
+            __m128 startDistance = _mm_add_ps(_mm_mul_ps(startX, startX), _mm_mul_ps(startY, startY));
+            __m128 endDistance = _mm_add_ps(_mm_mul_ps(endX, endX), _mm_mul_ps(endY, endY));
+            __m128 along = _mm_add_ps(_mm_mul_ps(startX, deltaX), _mm_mul_ps(startY, deltaY));
+            __m128 length = _mm_add_ps(_mm_mul_ps(deltaX, deltaX), _mm_mul_ps(deltaY, deltaY));
+            __m128 between = _mm_and_ps(_mm_cmplt_ps(along, zero), _mm_cmpgt_ps(along, _mm_sub_ps(zero, length)));
+            __m128 closest = _mm_cmplt_ps(_mm_mul_ps(_mm_sub_ps(startDistance, reach2), length),
+                                          _mm_mul_ps(along, along));
+            __m128 inside = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(startDistance, reach2), _mm_cmplt_ps(endDistance, reach2)),
+                                      _mm_and_ps(between, closest));
+            bits |= (unsigned long long)_mm_movemask_ps(inside) << (i - first);
+        }
+#endif
+        for(;
+            i < end;
+            i++)
+        {
+            bool inside = sweptCircleHit(fromX, fromY, moveX, moveY, x[i], y[i], prevX[i], prevY[i], radius[i] + r);
+            bits |= (unsigned long long)inside << (i - first);
+        }
+        hitMask[word] = bits;
+        hitCount += countSetBits(bits);
+    }
+    return(hitCount);
+}
+
+static int
+gridCellIndex(AsteroidGrid *grid, float x, float y)
+{
+    // Clamp as floats, converting something far off the grid to int first
+    // could overflow
+    float fx = (x - grid->minX) * grid->invCellSize;
+    float fy = (y - grid->minY) * grid->invCellSize;
+    if(fx < 0) fx = 0;
+    if(fy < 0) fy = 0;
+    if(fx > grid->cols - 1) fx = (float)(grid->cols - 1);
+    if(fy > grid->rows - 1) fy = (float)(grid->rows - 1);
+    return((int)fy * grid->cols + (int)fx);
+}
+
+// Covers [minX, maxX] x [minY, maxY] for queries up to reach in radius. Only
+// good until the pool changes, entries are live range indices.
+bool
+buildAsteroidGrid(AsteroidGrid *grid, Arena *arena, AsteroidPool *pool, float reach,
+                  float minX, float minY, float maxX, float maxY)
+{
+    float maxRadius = 0;
+    for(int i = 0;
+        i < pool->count;
+        i++)
+    {
+        maxRadius = (pool->radius[i] > maxRadius) ? pool->radius[i] : maxRadius;
+    }
+    
+    *grid = {};
+    grid->minX = minX;
+    grid->minY = minY;
+    grid->reach = reach;
+    float sparseCell = sqrtf((maxX - minX) * (maxY - minY) / (GRID_CELLS_PER_ASTEROID * (pool->count + 1)));
+    grid->cellSize = maxRadius + reach;
+    if(grid->cellSize < sparseCell) grid->cellSize = sparseCell;
+    grid->invCellSize = 1.0f / grid->cellSize;
+    grid->cols = (int)((maxX - minX) * grid->invCellSize) + 1;
+    grid->rows = (int)((maxY - minY) * grid->invCellSize) + 1;
+    int cellCount = grid->cols * grid->rows;
+    
+    grid->cellStart = arena_push_array(arena, int, cellCount + 1);
+    grid->entryX = arena_push_array(arena, float, pool->count);
+    grid->entryY = arena_push_array(arena, float, pool->count);
+    grid->entryRadius = arena_push_array(arena, float, pool->count);
+    grid->entryIndex = arena_push_array(arena, int, pool->count);
+    int *cell = arena_push_array(arena, int, pool->count);
+    if(!grid->cellStart || !grid->entryX || !grid->entryY || !grid->entryRadius || !grid->entryIndex || !cell)
+    {
+        return(false);
+    }
+    
+    // Counting sort: count per cell, prefix sum, scatter
+    memset(grid->cellStart, 0, (cellCount + 1) * sizeof(int));
+    for(int i = 0;
+        i < pool->count;
+        i++)
+    {
+        cell[i] = gridCellIndex(grid, pool->x[i], pool->y[i]);
+        grid->cellStart[cell[i] + 1]++;
+    }
+    for(int c = 0;
+        c < cellCount;
+        c++)
+    {
+        grid->cellStart[c + 1] += grid->cellStart[c];
+    }
+    
+    // NOTE(trist007): cellStart[c] is used as the fill cursor and ends up at
+    // the start of cell c + 1, shift it back after
+    for(int i = 0;
+        i < pool->count;
+        i++)
+    {
+        int e = grid->cellStart[cell[i]]++;
+        grid->entryX[e] = pool->x[i];
+        grid->entryY[e] = pool->y[i];
+        grid->entryRadius[e] = pool->radius[i];
+        grid->entryIndex[e] = i;
+    }
+    for(int c = cellCount;
+        c > 0;
+        c--)
+    {
+        grid->cellStart[c] = grid->cellStart[c - 1];
+    }
+    grid->cellStart[0] = 0;
+    
+    return(true);
+}
+
+// Lists the asteroids overlapping the circle in hitIndex, highest index first
+// like the brute force pass, and returns how many
+int
+queryAsteroidGrid(AsteroidGrid *grid, float px, float py, float r, int *hitIndex)
+{
+    Assert(r <= grid->reach);
+    int center = gridCellIndex(grid, px, py);
+    int cx = center % grid->cols;
+    int cy = center / grid->cols;
+    
+    int hitCount = 0;
+    for(int y = cy - 1;
+        y <= cy + 1;
+        y++)
+    {
+        if(y < 0 || y >= grid->rows) continue;
+        for(int x = cx - 1;
+            x <= cx + 1;
+            x++)
+        {
+            if(x < 0 || x >= grid->cols) continue;
+            int c = y * grid->cols + x;
+            int end = grid->cellStart[c + 1];
+            for(int e = grid->cellStart[c];
+                e < end;
+                e++)
+            {
+                float dx = grid->entryX[e] - px;
+                float dy = grid->entryY[e] - py;
+                float reach = grid->entryRadius[e] + r;
+                if((dx * dx + dy * dy) < reach * reach) hitIndex[hitCount++] = grid->entryIndex[e];
+            }
+            grid->pairTests += end - grid->cellStart[c];
+        }
+    }
+    
+    insertionSortDescending(hitIndex, hitCount);
+    return(hitCount);
+}
+
+void*
+arena_alloc_aligned(Arena *a, size_t bytes, size_t alignment)
+{
+    size_t address = (size_t)(a->base + a->used);
+    size_t padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+    a->used += padding;
+    
+    void *ptr = arena_alloc(a, bytes);
+    if(!ptr) a->used -= padding;
+    return(ptr);
+}
+
+// Carve a child arena out of the parent, e.g. one slice per worker thread
+Arena
+arena_sub(Arena *parent, size_t size)
+{
+    Arena result = {};
+    result.base = (unsigned char *)arena_alloc_aligned(parent, size, 64);
+    if(result.base)
+    {
+        result.size = size;
+        result.committed = size;
+        result.pageFlags = parent->pageFlags;
+    }
+    return(result);
+}
+
+// Reserve address space only, pages get committed as the arena grows
+bool
+arena_reserve(Arena *a, size_t size, int pageFlags)
+{
+    *a = {};
+    a->base = (unsigned char *)platformReserveMemory(size, pageFlags);
+    if(a->base)
+    {
+        a->size = size;
+        a->pageFlags = pageFlags;
+    }
+    return(a->base != 0);
+}
+
+void
+arena_release(Arena *a)
+{
+    if(a->base) platformReleaseMemory(a->base, a->size);
+    *a = {};
+}
+
+static bool
+arena_grow(Arena *a, size_t needed)
+{
+    bool result = false;
+    if(needed <= a->size)
+    {
+        size_t chunk = a->pageFlags ? ARENA_HUGE_PAGE_SIZE : ARENA_COMMIT_CHUNK;
+        size_t newCommitted = (needed + chunk - 1) & ~(chunk - 1);
+        if(newCommitted > a->size) newCommitted = a->size;
+        
+        size_t pageSize = platformCommitMemory(a->base + a->committed, newCommitted - a->committed, a->pageFlags);
+        if(pageSize)
+        {
+            if(pageSize >= ARENA_HUGE_PAGE_SIZE) a->hugeCommitted += newCommitted - a->committed;
+            a->committed = newCommitted;
+            result = true;
+        }
+    }
+    return(result);
+}
+
+void
+arena_reset(Arena *a)
+{
+    Assert(a->tempCount == 0);
+    a->used = 0;
+}
+
+TemporaryMemory
+beginTemporaryMemory(Arena *arena)
+{
+    TemporaryMemory result;
+    result.arena = arena;
+    result.used = arena->used;
+    arena->tempCount++;
+    return(result);
+}
+
+void
+endTemporaryMemory(TemporaryMemory temp)
+{
+    Arena *arena = temp.arena;
+    Assert(arena->used >= temp.used);
+    Assert(arena->tempCount > 0);
+    arena->used = temp.used;
+    arena->tempCount--;
+}
+
+void*
+arena_alloc(Arena *a, size_t bytes)
+{
+    void *ptr = 0;
+    if(a->used + bytes <= a->committed || arena_grow(a, a->used + bytes))
+    {
+        ptr = a->base + a->used;
+        a->used += bytes;
+        if(a->used > a->highWater) a->highWater = a->used;
+    }
+    else
+    {
+        a->failedAllocs++;
+    }
+    return(ptr);
+}
+
+// splitmix64 spreads the seed so nearby seeds give unrelated series
+RandomSeries
+seedRandomSeries(unsigned long long seed)
+{
+    RandomSeries result;
+    for(int i = 0;
+        i < 4;
+        i += 2)
+    {
+        seed += 0x9E3779B97F4A7C15ULL;
+        unsigned long long z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z ^= z >> 31;
+        result.s[i] = (unsigned int)z;
+        result.s[i + 1] = (unsigned int)(z >> 32);
+    }
+    
+    // All zero is the one state xoshiro never leaves
+    if(!(result.s[0] | result.s[1] | result.s[2] | result.s[3])) result.s[0] = 1;
+    return(result);
+}
+
+unsigned int
+randomNext(RandomSeries *series)
+{
+    unsigned int *s = series->s;
+    unsigned int result = s[0] + s[3];
+    unsigned int t = s[1] << 9;
+    
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 11) | (s[3] >> 21);
+    
+    return(result);
+}
+
+// Inclusive like raylib's GetRandomValue. Scales by the high bits, the low
+// bits of xoshiro128+ are the weak ones.
+int
+randomRange(RandomSeries *series, int min, int max)
+{
+    if(min > max)
+    {
+        int tmp = max;
+        max = min;
+        min = tmp;
+    }
+    unsigned long long range = (unsigned long long)(max - min) + 1;
+    return(min + (int)((randomNext(series) * range) >> 32));
+}
@@ -0,0 +1,490 @@
+#if !defined(ASTEROIDS_H)
+#define ASTEROIDS_H
+
+// NOTE(trist007): Platform independent game layer. Nothing in here may call
+// into raylib's window, input or drawing API so the simulation can be driven
+// by the win32 layer or by the headless linux runner.
+
+#include <stddef.h>
+#include "raymath.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+#if !defined(RL_COLOR_TYPE)
+// Same layout as raylib's Color so the win32 layer can pass it straight through
+typedef struct Color
+{
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+    unsigned char a;
+} Color;
+#define RL_COLOR_TYPE
+#endif
+
+// Fixed simulation rate, the platform layer renders as fast as it likes and
+// interpolates between the last two ticks
+#define SIM_HZ 120
+#define SIM_DT (1.0f / SIM_HZ)
+
+// Pool capacities the game normally runs with, see GameConfig
+#define DEFAULT_BULLET_CAPACITY 20
+#define DEFAULT_LARGE_ASTEROID_CAPACITY 8
+#define DEFAULT_SMALL_ASTEROID_CAPACITY 12
+
+// Asteroid size classes
+#define ASTEROID_LARGE 0
+#define ASTEROID_SMALL 1
+#define ASTEROID_CLASS_COUNT 2
+
+// A query circle near a corner of the wrapping world has itself and three
+// shifted copies to test, see wrapImages
+#define WRAP_MAX_IMAGES 4
+
+// Asteroid arrays are padded to whole SIMD groups
+#define ASTEROID_SIMD_WIDTH 8
+#define ASTEROID_POOL_SLOTS(capacity) (((capacity) + ASTEROID_SIMD_WIDTH - 1) & ~(ASTEROID_SIMD_WIDTH - 1))
+
+// Circles per compare in overlapAsteroidsMask, picked at compile time like
+// the batch kernels. AVX2 needs -mavx2 (or /arch:AVX2), x64 always has SSE2.
+#if defined(__AVX2__)
+#define NARROWPHASE_LANES 8
+#elif defined(__SSE2__) || defined(_M_X64)
+#define NARROWPHASE_LANES 4
+#else
+#define NARROWPHASE_LANES 1
+#endif
+
+// How bullets find the asteroids they might hit, GameConfig.broadphase
+#define BROADPHASE_BRUTE_FORCE 0 // every bullet against every asteroid
+#define BROADPHASE_GRID 1        // uniform grid rebuilt every tick
+#define BROADPHASE_SWEEP 2       // sweep and prune along x, order kept between ticks
+
+// Cells grow past the asteroid reach when there would be more than this many
+// per asteroid, clearing empty cells would cost more than it saves
+#define GRID_CELLS_PER_ASTEROID 2
+
+// GameUpdate phases, for GameTimings
+#define TIMED_BLOCK_SHIP 0
+#define TIMED_BLOCK_BULLETS 1
+#define TIMED_BLOCK_SPAWN 2
+#define TIMED_BLOCK_MOVE_ASTEROIDS 3
+#define TIMED_BLOCK_DESPAWN 4
+#define TIMED_BLOCK_BULLET_COLLISION 5
+#define TIMED_BLOCK_SHIP_COLLISION 6
+#define TIMED_BLOCK_COUNT 7
+
+// Helper macros
+#define Assert(expr) if(!(expr)) { *(int *)0 = 0; }
+#define MASK_WORDS(capacity) (((capacity) + 63) / 64)
+// NOTE(trist007): Handmade style cycle counters, they only read the TSC when
+// the GameState has somewhere to put the result
+#define BEGIN_TIMED_BLOCK(gs, id) unsigned long long timedBlockStart##id = (gs)->timings ? __rdtsc() : 0
+#define END_TIMED_BLOCK(gs, id) if((gs)->timings) (gs)->timings->cycles[id] += __rdtsc() - timedBlockStart##id
+#define MEGABYTES(num) ((num) * 1024ULL * 1024ULL)
+#define GIGABYTES(num) (MEGABYTES(num) * 1024ULL)
+#define arena_push(arena, type) (type *)arena_alloc(arena, sizeof(type))
+// Arrays are cache line aligned so SIMD loops over them start on a boundary
+#define arena_push_array(arena, type, count) (type *)arena_alloc_aligned(arena, (count) * sizeof(type), 64)
+
+// Index of the lowest set bit, value must not be 0
+inline int
+findLeastSignificantSetBit(unsigned long long value)
+{
+#if defined(_MSC_VER)
+    unsigned long result;
+    _BitScanForward64(&result, value);
+    return((int)result);
+#else
+    return(__builtin_ctzll(value));
+#endif
+}
+
+// Index of the highest set bit, value must not be 0
+inline int
+findMostSignificantSetBit(unsigned long long value)
+{
+#if defined(_MSC_VER)
+    unsigned long result;
+    _BitScanReverse64(&result, value);
+    return((int)result);
+#else
+    return(63 - __builtin_clzll(value));
+#endif
+}
+
+// NOTE(trist007): without -mpopcnt the builtin is a call into libgcc, the
+// bit twiddling inline is cheaper than the call
+inline int
+countSetBits(unsigned long long value)
+{
+#if defined(_MSC_VER)
+    return((int)__popcnt64(value));
+#elif defined(__POPCNT__)
+    return(__builtin_popcountll(value));
+#else
+    value = value - ((value >> 1) & 0x5555555555555555ULL);
+    value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return((int)((value * 0x0101010101010101ULL) >> 56));
+#endif
+}
+
+// Arena page backing, passed through to the platform when committing
+#define ARENA_PAGES_DEFAULT 0
+#define ARENA_PAGES_TRANSPARENT_HUGE 1 // ask the kernel to back with huge pages when it can
+#define ARENA_PAGES_EXPLICIT_HUGE 2    // hugetlb pool, falls back to transparent huge pages
+
+// Growable arenas commit in chunks of this, huge page arenas in 2 MB
+#define ARENA_COMMIT_CHUNK MEGABYTES(1)
+#define ARENA_HUGE_PAGE_SIZE MEGABYTES(2)
+
+// NOTE(trist007): size is reserved address space, committed is how much of
+// it is backed by memory. arena_reserve arenas start with nothing committed
+// and grow on demand, fixed arenas (arena_sub) are fully committed. Running
+// out returns 0 from arena_alloc instead of crashing.
+typedef struct
+{
+    //uint8_t *base;
+    unsigned char *base;
+    size_t size;
+    size_t used;
+    size_t committed;
+    int pageFlags;
+    
+    // Open TemporaryMemory blocks, must be 0 when the arena gets reset
+    int tempCount;
+    
+    // Stats
+    size_t highWater;
+    size_t hugeCommitted;
+    size_t failedAllocs;
+} Arena;
+
+// Marks a point in an arena, everything pushed after it is thrown away by
+// endTemporaryMemory. Blocks nest and must end in reverse order.
+typedef struct
+{
+    Arena *arena;
+    size_t used;
+} TemporaryMemory;
+
+// NOTE(trist007): xoshiro128+, every game carries its own so runs replay
+// bit for bit from a seed and parallel games share no hidden state. The
+// batch keeps the same generator per lane.
+typedef struct
+{
+    unsigned int s[4];
+} RandomSeries;
+
+// NOTE(trist007): velocities are in pixels per second and every entity keeps
+// where it was at the previous tick so the renderer can interpolate
+typedef struct
+{
+    Vector2 pos;
+    Vector2 prevPos;
+    Vector2 velocity;
+    Color color;
+    float thrust;
+    float friction;
+    float rotation;
+    float prevRotation;
+    float turnSpeed;
+    float size;
+} Ship;
+
+typedef struct
+{
+    Vector2 pos;
+    Vector2 prevPos;
+    Vector2 velocity;
+    
+    // Seconds until it fizzles out, only counts down when the world wraps
+    float timeLeft;
+    
+    // Bumped every time the slot is released, see BulletHandle
+    unsigned int generation;
+    bool active;
+} Bullet;
+
+// NOTE(trist007): generational handles, for holding on to an entity across
+// ticks (target locks, homing, replication). Slots get recycled, so a handle
+// carries the generation its slot had when it was taken. Releasing an entity
+// bumps the generation, which makes every old handle to it fail lookup in
+// O(1) without searching. Generations start at 1 so a zeroed handle never
+// resolves.
+typedef struct
+{
+    int index;
+    unsigned int generation;
+} BulletHandle;
+
+// id is a stable slot in the pool's id table, not the asteroid's index in
+// the live range, which changes every time something is swap removed
+typedef struct
+{
+    int id;
+    unsigned int generation;
+} AsteroidHandle;
+
+// Occupancy and spawn counts for an entity pool
+typedef struct
+{
+    int live;
+    int peak;
+    long long spawns;
+    long long failedSpawns;
+} PoolStats;
+
+// NOTE(trist007): every asteroid of every size lives in one structure of
+// arrays pool. The live ones are packed into [0, count) and despawning swaps
+// the last one into the hole, so every pass runs over exactly the live
+// asteroids with no active checks and costs what is alive, not capacity.
+// sizeClass says large or small, classLimit caps how many of each there can
+// be. Direction isn't stored, it is the normalized velocity.
+typedef struct
+{
+    int capacity;
+    int count;
+    int classLimit[ASTEROID_CLASS_COUNT];
+    PoolStats classStats[ASTEROID_CLASS_COUNT];
+    
+    // How far past the screen each class gets before it despawns
+    float classMargin[ASTEROID_CLASS_COUNT];
+    
+    float *x;
+    float *y;
+    float *prevX;
+    float *prevY;
+    float *vx;
+    float *vy;
+    float *radius;
+    int *sizeClass;
+    
+    // Handle ids. id[i] is the id of the asteroid at index i, and
+    // [count, capacity) holds the free ids, so removing swaps the dead id to
+    // just past the live range and adding takes it from there. denseIndex
+    // maps back from an id and generation is per id.
+    int *id;
+    int *denseIndex;
+    unsigned int *generation;
+    
+    // Asteroids by left edge as of the last BROADPHASE_SWEEP tick. They fly
+    // straight, so next tick it is nearly sorted still.
+    AsteroidHandle *sweepOrder;
+    int sweepCount;
+} AsteroidPool;
+
+// NOTE(trist007): bullets are a sparse pool, slots stay put while they fly.
+// activeMask has a bit per slot mirroring Bullet.active, 64 slots a word, so
+// passes over the live ones walk the set bits instead of testing every slot.
+typedef struct
+{
+    int capacity;
+    Bullet *bullet;
+    unsigned long long *activeMask;
+    int maskWords;
+    
+    // Free slot stack for bullet[], firing pops and a bullet going away pushes
+    int *freeIndex;
+    int freeCount;
+    PoolStats stats;
+} BulletPool;
+
+// NOTE(trist007): pool sizes are picked when a game is set up and the pools
+// come out of its arena right behind the GameState, so a stress run can ask
+// for 100k asteroids without recompiling. Restarting keeps the pools.
+typedef struct
+{
+    int bulletCapacity;
+    int largeAsteroidCapacity;
+    int smallAsteroidCapacity;
+    
+    // BROADPHASE_, brute force is cheapest at the default pool sizes
+    int broadphase;
+    
+    // Test bullets and the ship along their whole path over the tick instead
+    // of where they end up, so nothing tunnels through a small asteroid when
+    // the sim ticks slower than SIM_HZ or the asteroids get fast
+    bool sweptCollision;
+    
+    // The screen is a torus: the ship, bullets and asteroids all leave one
+    // edge and come back on the opposite one, and collisions are caught
+    // across the seams. Asteroids stay alive instead of despawning off
+    // screen, bullets fizzle out after bulletLifetime.
+    bool wrapWorld;
+} GameConfig;
+
+// Cycles spent in each TIMED_BLOCK_ phase and bullet asteroid circle tests
+// done, added to every tick
+typedef struct
+{
+    unsigned long long cycles[TIMED_BLOCK_COUNT];
+    long long pairTests;
+    
+    // Places the sweep's insertion sort moved something by
+    long long sortShifts;
+} GameTimings;
+
+// NOTE(trist007): uniform grid over the asteroids, built in the transient
+// arena with a counting sort so each cell's asteroids sit together. Cells are
+// at least the biggest asteroid radius plus the bullet radius across, so a
+// bullet only has to look in its own cell and the 8 around it, and at most
+// GRID_CELLS_PER_ASTEROID cells per asteroid. Positions off
+// the grid clamp to the edge cells, which keeps neighbours neighbours.
+// Entries carry a copy of the circle, so the tests run down a cell's entries
+// in order, and the asteroid's index in the live range. Collision detection
+// doesn't touch the pool, so the indices hold for the whole pass.
+typedef struct
+{
+    float minX;
+    float minY;
+    float cellSize;
+    float invCellSize;
+    
+    // Biggest circle radius queries may use
+    float reach;
+    int cols;
+    int rows;
+    
+    // Asteroids in cell c are entries [cellStart[c], cellStart[c + 1])
+    int *cellStart;
+    float *entryX;
+    float *entryY;
+    float *entryRadius;
+    int *entryIndex;
+    
+    long long pairTests;
+} AsteroidGrid;
+
+// NOTE(trist007): bullet collisions run in two passes. Detection reads the
+// bullets and asteroids and writes an event per hit into the transient arena
+// without changing either, so it could be split up across threads. The
+// resolve pass then applies the events in bullet slot order. Handles rather
+// than indices since resolving swap removes asteroids.
+typedef struct
+{
+    int bullet;
+    AsteroidHandle asteroid;
+} HitEvent;
+
+typedef struct
+{
+    HitEvent *event;
+    int count;
+} HitEventQueue;
+
+typedef struct
+{
+    GameConfig config;
+    
+    // Assets
+    Ship ship;
+    BulletPool bullets;
+    AsteroidPool asteroids;
+    
+    // Asteroid attributes
+    float asteroidSpeed;
+    Vector2 asteroidTarget;
+    
+    // Implement difficulty where every 10 seconds 0.2f gets added
+    float asteroidSpeedMultiplier;
+    
+    // size of bullet
+    float bulletRadius;
+    float bulletSpeed;
+    float bulletLifetime;
+    
+    // Variables
+    bool gameOver;
+    RandomSeries random;
+    
+    // Per frame scratch (collision lists, sort buffers ...), GameUpdate
+    // empties it at the end of every tick
+    Arena *transient;
+    
+    // Set by a profiling runner, 0 in the game
+    GameTimings *timings;
+    
+    // Timer
+    float gameTimer;
+    float speedIncreaseInterval;
+    
+    float asteroidSpawnTimer;
+    float asteroidSpawnInterval;
+    
+} GameState;
+
+// Per frame controls, filled in by the platform layer
+typedef struct
+{
+    bool rotateLeft;
+    bool rotateRight;
+    bool thrust;
+    bool reverse;
+    
+    // Edge triggered, only set on the frame the fire key went down
+    bool fire;
+} GameInput;
+
+// Screen resolution
+extern int screenWidth;
+extern int screenHeight;
+
+// Forward declarations / Function prototypes
+GameConfig defaultGameConfig(void);
+size_t gameStateSize(GameConfig *config);
+GameState *pushGameState(Arena *arena, GameConfig *config);
+GameState *initializeGame(Arena *arena, Arena *transient, unsigned long long seed, GameConfig *config);
+void initializeGameState(GameState *gs, Arena *transient, unsigned long long seed);
+void GameUpdate(GameState *gs, GameInput *input, float dt);
+void spawnSmallAsteroid(GameState *gs, Vector2 asteroidPos, Vector2 asteroidVelocity);
+int allocateBullet(BulletPool *pool);
+void releaseBullet(BulletPool *pool, int index);
+BulletHandle getBulletHandle(BulletPool *pool, int index);
+int lookupBullet(BulletPool *pool, BulletHandle handle);
+bool pushBulletPool(Arena *arena, BulletPool *pool, int capacity);
+void resetBulletPool(BulletPool *pool);
+bool pushAsteroidPool(Arena *arena, AsteroidPool *pool, int capacity);
+int addAsteroid(AsteroidPool *pool, int sizeClass);
+void removeAsteroid(AsteroidPool *pool, int index);
+void resetAsteroidIds(AsteroidPool *pool);
+AsteroidHandle getAsteroidHandle(AsteroidPool *pool, int index);
+int lookupAsteroid(AsteroidPool *pool, AsteroidHandle handle);
+int despawnAsteroids(AsteroidPool *pool, float width, float height);
+int wrapAsteroids(AsteroidPool *pool, float width, float height);
+int wrapImages(GameConfig *config, Vector2 pos, float reach, Vector2 *offset);
+void moveAsteroids(float * __restrict x, float * __restrict y, float * __restrict prevX, float * __restrict prevY,
+                   float * __restrict vx, float * __restrict vy, int count, float dt);
+int overlapAsteroids(float * __restrict x, float * __restrict y, float * __restrict radius, int count,
+                     float px, float py, float r, int * __restrict hit);
+int overlapAsteroidsMask(float *x, float *y, float *radius, int count, float px, float py, float r,
+                         unsigned long long *hitMask);
+int sweptOverlapAsteroidsMask(float *x, float *y, float *prevX, float *prevY, float *radius, int count,
+                              float fromX, float fromY, float toX, float toY, float r, unsigned long long *hitMask);
+bool buildAsteroidGrid(AsteroidGrid *grid, Arena *arena, AsteroidPool *pool, float reach,
+                       float minX, float minY, float maxX, float maxY);
+int queryAsteroidGrid(AsteroidGrid *grid, float px, float py, float r, int *hitIndex);
+void *arena_alloc(Arena *a, size_t bytes);
+void *arena_alloc_aligned(Arena *a, size_t bytes, size_t alignment);
+Arena arena_sub(Arena *parent, size_t size);
+bool arena_reserve(Arena *a, size_t size, int pageFlags);
+void arena_release(Arena *a);
+void arena_reset(Arena *a);
+TemporaryMemory beginTemporaryMemory(Arena *arena);
+void endTemporaryMemory(TemporaryMemory temp);
+RandomSeries seedRandomSeries(unsigned long long seed);
+unsigned int randomNext(RandomSeries *series);
+int randomRange(RandomSeries *series, int min, int max);
+
+// Provided by the platform layer: virtual memory for growable arenas.
+// Commit returns the page size that ended up backing the range, 0 on failure.
+void *platformReserveMemory(size_t size, int pageFlags);
+size_t platformCommitMemory(void *base, size_t size, int pageFlags);
+void platformReleaseMemory(void *base, size_t size);
+
+#endif
@@ -0,0 +1,692 @@
+#include "asteroids_batch.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BATCH_SSE2 1
+#else
+#define BATCH_SSE2 0
+#endif
+
+static bool
+batchAllocBullets(Arena *arena, BatchBullets *b, int slotCount, int laneCount)
+{
+    int count = slotCount * laneCount;
+    b->slotCount = slotCount;
+    b->x = arena_push_array(arena, float, count);
+    b->y = arena_push_array(arena, float, count);
+    b->vx = arena_push_array(arena, float, count);
+    b->vy = arena_push_array(arena, float, count);
+    b->active = arena_push_array(arena, int, count);
+    b->hit = arena_push_array(arena, int, count);
+    return(b->x && b->y && b->vx && b->vy && b->active && b->hit);
+}
+
+static bool
+batchAllocAsteroids(Arena *arena, BatchAsteroids *a, int slotCount, int laneCount)
+{
+    int count = slotCount * laneCount;
+    a->slotCount = slotCount;
+    a->x = arena_push_array(arena, float, count);
+    a->y = arena_push_array(arena, float, count);
+    a->vx = arena_push_array(arena, float, count);
+    a->vy = arena_push_array(arena, float, count);
+    a->size = arena_push_array(arena, float, count);
+    a->active = arena_push_array(arena, int, count);
+    a->hit = arena_push_array(arena, int, count);
+    return(a->x && a->y && a->vx && a->vy && a->size && a->active && a->hit);
+}
+
+// Put one lane back to the state initializeGameState would give it
+static void
+batchResetGame(GameBatch *batch, int game, unsigned long long seed)
+{
+    int lanes = batch->laneCount;
+    GameState *rules = &batch->rules;
+    
+    RandomSeries series = seedRandomSeries(seed);
+    batch->random.s0[game] = series.s[0];
+    batch->random.s1[game] = series.s[1];
+    batch->random.s2[game] = series.s[2];
+    batch->random.s3[game] = series.s[3];
+    
+    batch->shipX[game] = rules->ship.pos.x;
+    batch->shipY[game] = rules->ship.pos.y;
+    batch->shipVX[game] = 0.0f;
+    batch->shipVY[game] = 0.0f;
+    batch->shipRotation[game] = rules->ship.rotation;
+    batch->asteroidSpeedMultiplier[game] = rules->asteroidSpeedMultiplier;
+    batch->gameTimer[game] = 0.0f;
+    batch->asteroidSpawnTimer[game] = 0.0f;
+    batch->gameOver[game] = 0;
+    
+    for(int slot = 0;
+        slot < batch->bullets.slotCount;
+        slot++)
+    {
+        batch->bullets.active[slot * lanes + game] = 0;
+        batch->bullets.hit[slot * lanes + game] = 0;
+    }
+    for(int slot = 0;
+        slot < batch->largeAsteroids.slotCount;
+        slot++)
+    {
+        batch->largeAsteroids.active[slot * lanes + game] = 0;
+        batch->largeAsteroids.hit[slot * lanes + game] = 0;
+    }
+    for(int slot = 0;
+        slot < batch->smallAsteroids.slotCount;
+        slot++)
+    {
+        batch->smallAsteroids.active[slot * lanes + game] = 0;
+        batch->smallAsteroids.hit[slot * lanes + game] = 0;
+    }
+}
+
+// Lane g is seeded with seed + g, the same as a GameState for game g would
+// be. 0 when the arena runs out.
+GameBatch *
+initializeGameBatch(Arena *arena, int gameCount, unsigned long long seed)
+{
+    GameBatch *batch = arena_push(arena, GameBatch);
+    if(!batch) return(0);
+    
+    // NOTE(trist007): rules only carries the tunables and the capacities,
+    // its own pools stay empty
+    batch->rules = {};
+    batch->rules.config = defaultGameConfig();
+    initializeGameState(&batch->rules, 0, seed);
+    GameConfig *config = &batch->rules.config;
+    
+    int lanes = (gameCount + BATCH_LANE_WIDTH - 1) & ~(BATCH_LANE_WIDTH - 1);
+    batch->gameCount = gameCount;
+    batch->laneCount = lanes;
+    batch->gamesFinished = 0;
+    
+    batch->shipX = arena_push_array(arena, float, lanes);
+    batch->shipY = arena_push_array(arena, float, lanes);
+    batch->shipVX = arena_push_array(arena, float, lanes);
+    batch->shipVY = arena_push_array(arena, float, lanes);
+    batch->shipRotation = arena_push_array(arena, float, lanes);
+    batch->asteroidSpeedMultiplier = arena_push_array(arena, float, lanes);
+    batch->gameTimer = arena_push_array(arena, float, lanes);
+    batch->asteroidSpawnTimer = arena_push_array(arena, float, lanes);
+    batch->gameOver = arena_push_array(arena, int, lanes);
+    batch->random.s0 = arena_push_array(arena, unsigned int, lanes);
+    batch->random.s1 = arena_push_array(arena, unsigned int, lanes);
+    batch->random.s2 = arena_push_array(arena, unsigned int, lanes);
+    batch->random.s3 = arena_push_array(arena, unsigned int, lanes);
+    batch->spawnSlot = arena_push_array(arena, int, lanes);
+    batch->spawnAngle = arena_push_array(arena, unsigned int, lanes);
+    batch->spawnSize = arena_push_array(arena, unsigned int, lanes);
+    
+    if(!batch->shipX || !batch->shipY || !batch->shipVX || !batch->shipVY || !batch->shipRotation ||
+       !batch->asteroidSpeedMultiplier || !batch->gameTimer || !batch->asteroidSpawnTimer || !batch->gameOver ||
+       !batch->random.s0 || !batch->random.s1 || !batch->random.s2 || !batch->random.s3 || !batch->spawnSlot ||
+       !batch->spawnAngle || !batch->spawnSize)
+    {
+        return(0);
+    }
+    
+    Assert(config->largeAsteroidCapacity <= BATCH_MAX_SLOTS && config->smallAsteroidCapacity <= BATCH_MAX_SLOTS);
+    if(!batchAllocBullets(arena, &batch->bullets, config->bulletCapacity, lanes) ||
+       !batchAllocAsteroids(arena, &batch->largeAsteroids, config->largeAsteroidCapacity, lanes) ||
+       !batchAllocAsteroids(arena, &batch->smallAsteroids, config->smallAsteroidCapacity, lanes))
+    {
+        return(0);
+    }
+    
+    // NOTE(trist007): padding lanes are reset too so the row loops can run
+    // over all of them without reading garbage
+    for(int game = 0;
+        game < lanes;
+        game++)
+    {
+        batchResetGame(batch, game, seed + game);
+        batch->spawnSlot[game] = 0;
+    }
+    
+    // Keep all positions finite even for slots that have never been used
+    int bulletCount = batch->bullets.slotCount * lanes;
+    for(int i = 0;
+        i < bulletCount;
+        i++)
+    {
+        batch->bullets.x[i] = batch->bullets.y[i] = 0.0f;
+        batch->bullets.vx[i] = batch->bullets.vy[i] = 0.0f;
+    }
+    BatchAsteroids *pools[2] = { &batch->largeAsteroids, &batch->smallAsteroids };
+    for(int p = 0;
+        p < 2;
+        p++)
+    {
+        int count = pools[p]->slotCount * lanes;
+        for(int i = 0;
+            i < count;
+            i++)
+        {
+            pools[p]->x[i] = pools[p]->y[i] = 0.0f;
+            pools[p]->vx[i] = pools[p]->vy[i] = 0.0f;
+            pools[p]->size[i] = 0.0f;
+        }
+    }
+    
+    return(batch);
+}
+
+unsigned int
+batchRandomNext(BatchRandom *random, int game)
+{
+    RandomSeries series = {{ random->s0[game], random->s1[game], random->s2[game], random->s3[game] }};
+    unsigned int result = randomNext(&series);
+    random->s0[game] = series.s[0];
+    random->s1[game] = series.s[1];
+    random->s2[game] = series.s[2];
+    random->s3[game] = series.s[3];
+    return(result);
+}
+
+static int
+batchRandomRange(BatchRandom *random, int game, int min, int max)
+{
+    unsigned long long range = (unsigned long long)(max - min) + 1;
+    return(min + (int)((batchRandomNext(random, game) * range) >> 32));
+}
+
+// NOTE(trist007): steps the generator of every lane whose mask is set and
+// writes its number to out, other lanes keep their state so each lane's
+// sequence only depends on its own draws. laneCount is a multiple of
+// BATCH_LANE_WIDTH.
+void
+batchRandomFill(BatchRandom *random, int *mask, unsigned int *out, int laneCount)
+{
+#if BATCH_SSE2
+    __m128i zero = _mm_setzero_si128();
+    for(int lane = 0;
+        lane < laneCount;
+        lane += 4)
+    {
+        __m128i s0 = _mm_load_si128((__m128i *)(random->s0 + lane));
+        __m128i s1 = _mm_load_si128((__m128i *)(random->s1 + lane));
+        __m128i s2 = _mm_load_si128((__m128i *)(random->s2 + lane));
+        __m128i s3 = _mm_load_si128((__m128i *)(random->s3 + lane));
+        __m128i keep = _mm_cmpeq_epi32(_mm_load_si128((__m128i *)(mask + lane)), zero);
+        
+        _mm_store_si128((__m128i *)(out + lane), _mm_add_epi32(s0, s3));
+        
+        __m128i t = _mm_slli_epi32(s1, 9);
+        __m128i n2 = _mm_xor_si128(s2, s0);
+        __m128i n3 = _mm_xor_si128(s3, s1);
+        __m128i n1 = _mm_xor_si128(s1, n2);
+        __m128i n0 = _mm_xor_si128(s0, n3);
+        n2 = _mm_xor_si128(n2, t);
+        n3 = _mm_or_si128(_mm_slli_epi32(n3, 11), _mm_srli_epi32(n3, 21));
+        
+        _mm_store_si128((__m128i *)(random->s0 + lane), _mm_or_si128(_mm_and_si128(keep, s0), _mm_andnot_si128(keep, n0)));
+        _mm_store_si128((__m128i *)(random->s1 + lane), _mm_or_si128(_mm_and_si128(keep, s1), _mm_andnot_si128(keep, n1)));
+        _mm_store_si128((__m128i *)(random->s2 + lane), _mm_or_si128(_mm_and_si128(keep, s2), _mm_andnot_si128(keep, n2)));
+        _mm_store_si128((__m128i *)(random->s3 + lane), _mm_or_si128(_mm_and_si128(keep, s3), _mm_andnot_si128(keep, n3)));
+    }
+#else
+    for(int lane = 0;
+        lane < laneCount;
+        lane++)
+    {
+        if(mask[lane]) out[lane] = batchRandomNext(random, lane);
+    }
+#endif
+}
+
+// Same as spawnSmallAsteroid but into one lane of the batch
+static void
+batchSpawnSmallAsteroid(GameBatch *batch, int game, float x, float y, float vx, float vy)
+{
+    BatchAsteroids *small = &batch->smallAsteroids;
+    int lanes = batch->laneCount;
+    
+    for(int slot = 0;
+        slot < small->slotCount;
+        slot++)
+    {
+        int i = slot * lanes + game;
+        if(!small->active[i])
+        {
+            small->x[i] = x;
+            small->y[i] = y;
+            small->size[i] = (float)batchRandomRange(&batch->random, game, 5, 10);
+            small->active[i] = 1;
+            
+            // Parent direction is its normalized velocity
+            Vector2 direction = Vector2Normalize({ vx, vy });
+            
+            // Add some spread
+            float spread = batchRandomRange(&batch->random, game, -40, 40) * DEG2RAD;
+            float dx = direction.x * cosf(spread) - direction.y * sinf(spread);
+            float dy = direction.x * sinf(spread) + direction.y * cosf(spread);
+            
+            small->vx[i] = dx * batch->rules.asteroidSpeed;
+            small->vy[i] = dy * batch->rules.asteroidSpeed;
+            break;
+        }
+    }
+}
+
+// Integrate every slot of every game and despawn the ones that left the
+// margin. Inactive slots get moved too, it is cheaper than branching.
+static void
+batchMoveAsteroids(BatchAsteroids *a, int laneCount, float dt, float margin)
+{
+    int count = a->slotCount * laneCount;
+    float *x = a->x;
+    float *y = a->y;
+    float *vx = a->vx;
+    float *vy = a->vy;
+    int *active = a->active;
+    
+    float minX = -margin;
+    float maxX = screenWidth + margin;
+    float minY = -margin;
+    float maxY = screenHeight + margin;
+    
+    for(int i = 0;
+        i < count;
+        i++)
+    {
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+        
+        int inside = (x[i] >= minX) & (x[i] <= maxX) & (y[i] >= minY) & (y[i] <= maxY);
+        active[i] &= inside;
+    }
+}
+
+static inline int
+batchAnyActive(int *active)
+{
+    int any = 0;
+    for(int lane = 0;
+        lane < BATCH_LANE_WIDTH;
+        lane++)
+    {
+        any |= active[lane];
+    }
+    return(any);
+}
+
+// One SIMD group of lanes: flag the lanes where this bullet slot overlaps
+// this asteroid slot
+static inline void
+batchCollideLanes(float *bx, float *by, int *bActive, int *bHit,
+                  float *ax, float *ay, float *aSize, int *aActive, int *aHit,
+                  float bulletRadius)
+{
+#if BATCH_SSE2
+    __m128 radius = _mm_set1_ps(bulletRadius);
+    for(int lane = 0;
+        lane < BATCH_LANE_WIDTH;
+        lane += 4)
+    {
+        __m128 dx = _mm_sub_ps(_mm_load_ps(bx + lane), _mm_load_ps(ax + lane));
+        __m128 dy = _mm_sub_ps(_mm_load_ps(by + lane), _mm_load_ps(ay + lane));
+        __m128 r = _mm_add_ps(_mm_load_ps(aSize + lane), radius);
+        
+        // Squared distance, no sqrtf. Compare gives all ones, active is 0 or 1.
+        __m128 inside = _mm_cmplt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(r, r));
+        __m128i active = _mm_and_si128(_mm_load_si128((__m128i *)(bActive + lane)),
+                                       _mm_load_si128((__m128i *)(aActive + lane)));
+        __m128i hit = _mm_and_si128(active, _mm_castps_si128(inside));
+        
+        _mm_store_si128((__m128i *)(bHit + lane), _mm_or_si128(_mm_load_si128((__m128i *)(bHit + lane)), hit));
+        _mm_store_si128((__m128i *)(aHit + lane), _mm_or_si128(_mm_load_si128((__m128i *)(aHit + lane)), hit));
+    }
+#else
+    for(int lane = 0;
+        lane < BATCH_LANE_WIDTH;
+        lane++)
+    {
+        float dx = bx[lane] - ax[lane];
+        float dy = by[lane] - ay[lane];
+        float r = aSize[lane] + bulletRadius;
+        
+        // Squared distance, no sqrtf
+        int hit = bActive[lane] & aActive[lane] & ((dx * dx + dy * dy) < (r * r));
+        bHit[lane] |= hit;
+        aHit[lane] |= hit;
+    }
+#endif
+}
+
+// Flag every bullet/asteroid pair that overlaps. Lanes are walked one SIMD
+// group at a time so the rows for the group stay in cache across all slot
+// pairs, and slots that are empty in every lane of the group get skipped.
+static void
+batchCollideBullets(BatchBullets *b, BatchAsteroids *a, int laneCount, float bulletRadius)
+{
+    int liveRows[BATCH_MAX_SLOTS];
+    
+    for(int group = 0;
+        group < laneCount;
+        group += BATCH_LANE_WIDTH)
+    {
+        int liveCount = 0;
+        for(int asteroidSlot = 0;
+            asteroidSlot < a->slotCount;
+            asteroidSlot++)
+        {
+            int asteroidRow = asteroidSlot * laneCount + group;
+            if(batchAnyActive(a->active + asteroidRow)) liveRows[liveCount++] = asteroidRow;
+        }
+        if(liveCount == 0) continue;
+        
+        for(int bulletSlot = 0;
+            bulletSlot < b->slotCount;
+            bulletSlot++)
+        {
+            int row = bulletSlot * laneCount + group;
+            if(!batchAnyActive(b->active + row)) continue;
+            
+            for(int live = 0;
+                live < liveCount;
+                live++)
+            {
+                int asteroidRow = liveRows[live];
+                batchCollideLanes(b->x + row, b->y + row, b->active + row, b->hit + row,
+                                  a->x + asteroidRow, a->y + asteroidRow, a->size + asteroidRow,
+                                  a->active + asteroidRow, a->hit + asteroidRow, bulletRadius);
+            }
+        }
+    }
+}
+
+// Of one game's asteroids in a class that are still there and were flagged
+// overlapping this bullet, the one nearest (fromX, fromY), the lower slot on
+// a tie. -1 when there is none, *nearestDistance gets its squared distance.
+static int
+batchNearestHit(BatchAsteroids *a, int laneCount, int game, float bx, float by, float fromX, float fromY,
+                float bulletRadius, float *nearestDistance)
+{
+    int nearest = -1;
+    for(int slot = 0;
+        slot < a->slotCount;
+        slot++)
+    {
+        int i = slot * laneCount + game;
+        float dx = bx - a->x[i];
+        float dy = by - a->y[i];
+        float r = a->size[i] + bulletRadius;
+        if(a->active[i] && a->hit[i] && (dx * dx + dy * dy) < (r * r))
+        {
+            float fx = a->x[i] - fromX;
+            float fy = a->y[i] - fromY;
+            float distance = fx * fx + fy * fy;
+            if(nearest < 0 || distance < *nearestDistance)
+            {
+                nearest = i;
+                *nearestDistance = distance;
+            }
+        }
+    }
+    return(nearest);
+}
+
+static void
+batchCollideShip(GameBatch *batch, BatchAsteroids *a)
+{
+    int lanes = batch->laneCount;
+    float shipSize = batch->rules.ship.size;
+    float *sx = batch->shipX;
+    float *sy = batch->shipY;
+    int *gameOver = batch->gameOver;
+    
+    for(int slot = 0;
+        slot < a->slotCount;
+        slot++)
+    {
+        float *ax = a->x + slot * lanes;
+        float *ay = a->y + slot * lanes;
+        float *aSize = a->size + slot * lanes;
+        int *aActive = a->active + slot * lanes;
+        
+        for(int game = 0;
+            game < lanes;
+            game++)
+        {
+            float dx = ax[game] - sx[game];
+            float dy = ay[game] - sy[game];
+            float r = aSize[game] + shipSize;
+            gameOver[game] |= aActive[game] & ((dx * dx + dy * dy) < (r * r));
+        }
+    }
+}
+
+void
+GameBatchUpdate(GameBatch *batch, GameInput *inputs, float dt)
+{
+    int lanes = batch->laneCount;
+    GameState *rules = &batch->rules;
+    
+    float turn = rules->ship.turnSpeed * dt;
+    float thrust = rules->ship.thrust * dt;
+    float friction = powf(rules->ship.friction, dt);
+    float width = (float)screenWidth;
+    float height = (float)screenHeight;
+    
+    // Control ship, one game at a time since the input is per game
+    for(int game = 0;
+        game < batch->gameCount;
+        game++)
+    {
+        GameInput *input = inputs + game;
+        float rotation = batch->shipRotation[game];
+        if(input->rotateRight) rotation += turn;
+        if(input->rotateLeft) rotation -= turn;
+        batch->shipRotation[game] = rotation;
+        
+        float push = (input->thrust ? thrust : 0.0f) - (input->reverse ? thrust : 0.0f);
+        batch->shipVX[game] += sinf(rotation) * push;
+        batch->shipVY[game] -= cosf(rotation) * push;
+        
+        if(input->fire)
+        {
+            BatchBullets *b = &batch->bullets;
+            for(int slot = 0;
+                slot < b->slotCount;
+                slot++)
+            {
+                int i = slot * lanes + game;
+                if(!b->active[i])
+                {
+                    b->active[i] = 1;
+                    b->x[i] = batch->shipX[game];
+                    b->y[i] = batch->shipY[game];
+                    b->vx[i] = sinf(rotation) * rules->bulletSpeed;
+                    b->vy[i] = -cosf(rotation) * rules->bulletSpeed;
+                    break;
+                }
+            }
+        }
+    }
+    
+    // Timers, ship motion and wrap across all games
+    for(int game = 0;
+        game < lanes;
+        game++)
+    {
+        float timer = batch->gameTimer[game] + dt;
+        int faster = timer >= rules->speedIncreaseInterval;
+        batch->asteroidSpeedMultiplier[game] += faster ? 0.5f : 0.0f;
+        batch->gameTimer[game] = faster ? 0.0f : timer;
+        batch->asteroidSpawnTimer[game] += dt;
+        
+        float x = batch->shipX[game] + batch->shipVX[game] * dt;
+        float y = batch->shipY[game] + batch->shipVY[game] * dt;
+        batch->shipVX[game] *= friction;
+        batch->shipVY[game] *= friction;
+        
+        // Wrap on the opposite end
+        x = (x < 0.0f) ? width : ((x > width) ? 0.0f : x);
+        y = (y < 0.0f) ? height : ((y > height) ? 0.0f : y);
+        batch->shipX[game] = x;
+        batch->shipY[game] = y;
+    }
+    
+    // Move bullets and deactivate the ones that left the screen
+    {
+        BatchBullets *b = &batch->bullets;
+        int count = b->slotCount * lanes;
+        for(int i = 0;
+            i < count;
+            i++)
+        {
+            b->x[i] += b->vx[i] * dt;
+            b->y[i] += b->vy[i] * dt;
+            
+            int inside = (b->x[i] >= 0.0f) & (b->x[i] <= width) & (b->y[i] >= 0.0f) & (b->y[i] <= height);
+            b->active[i] &= inside;
+        }
+    }
+    
+    // Spawn at most one large asteroid per game per interval. Find the slot
+    // each game spawns into first, then draw the random angles and sizes for
+    // all of them in one pass.
+    BatchAsteroids *large = &batch->largeAsteroids;
+    int spawning = 0;
+    for(int game = 0;
+        game < batch->gameCount;
+        game++)
+    {
+        batch->spawnSlot[game] = 0;
+        if(batch->asteroidSpawnTimer[game] >= rules->asteroidSpawnInterval)
+        {
+            for(int slot = 0;
+                slot < large->slotCount;
+                slot++)
+            {
+                if(!large->active[slot * lanes + game])
+                {
+                    // Stored one up so 0 can mean no spawn
+                    batch->spawnSlot[game] = slot + 1;
+                    spawning++;
+                    break;
+                }
+            }
+        }
+    }
+    
+    if(spawning)
+    {
+        batchRandomFill(&batch->random, batch->spawnSlot, batch->spawnAngle, lanes);
+        batchRandomFill(&batch->random, batch->spawnSlot, batch->spawnSize, lanes);
+        
+        for(int game = 0;
+            game < batch->gameCount;
+            game++)
+        {
+            if(batch->spawnSlot[game])
+            {
+                int i = (batch->spawnSlot[game] - 1) * lanes + game;
+                
+                // Get random angle and scale for asteroid, same mapping as randomRange
+                float angle = (int)((batch->spawnAngle[game] * 361ULL) >> 32) * DEG2RAD;
+                float spawnRadius = screenRadius + spawnMargin;
+                
+                Vector2 pos = { width / 2.0f + cosf(angle) * spawnRadius,
+                    height / 2.0f + sinf(angle) * spawnRadius };
+                Vector2 direction = Vector2Normalize(Vector2Subtract(rules->asteroidTarget, pos));
+                float speed = rules->asteroidSpeed * batch->asteroidSpeedMultiplier[game];
+                
+                large->x[i] = pos.x;
+                large->y[i] = pos.y;
+                large->vx[i] = direction.x * speed;
+                large->vy[i] = direction.y * speed;
+                large->size[i] = (float)(20 + (int)((batch->spawnSize[game] * 61ULL) >> 32));
+                large->active[i] = 1;
+                
+                batch->asteroidSpawnTimer[game] = 0.0f;
+            }
+        }
+    }
+    
+    batchMoveAsteroids(&batch->largeAsteroids, lanes, dt, 200.0f);
+    batchMoveAsteroids(&batch->smallAsteroids, lanes, dt, 175.0f);
+    
+    // NOTE(trist007): detection only flags hits, they get applied after every
+    // pair has been tested. Same as GameUpdate a bullet takes out only the
+    // flagged asteroid nearest where it came from, and a small asteroid split
+    // off this tick can't be hit until the next one, its slot was empty when
+    // the flags were set.
+    batchCollideBullets(&batch->bullets, &batch->largeAsteroids, lanes, rules->bulletRadius);
+    batchCollideBullets(&batch->bullets, &batch->smallAsteroids, lanes, rules->bulletRadius);
+    
+    {
+        BatchBullets *b = &batch->bullets;
+        BatchAsteroids *small = &batch->smallAsteroids;
+        int count = b->slotCount * lanes;
+        for(int i = 0;
+            i < count;
+            i++)
+        {
+            if(b->hit[i])
+            {
+                b->hit[i] = 0;
+                int game = i % lanes;
+                float fromX = b->x[i] - b->vx[i] * dt;
+                float fromY = b->y[i] - b->vy[i] * dt;
+                float largeDistance = 0;
+                float smallDistance = 0;
+                int largeHit = batchNearestHit(large, lanes, game, b->x[i], b->y[i], fromX, fromY,
+                                               rules->bulletRadius, &largeDistance);
+                int smallHit = batchNearestHit(small, lanes, game, b->x[i], b->y[i], fromX, fromY,
+                                               rules->bulletRadius, &smallDistance);
+                
+                // Large one first on a tie
+                if(largeHit >= 0 && (smallHit < 0 || largeDistance <= smallDistance))
+                {
+                    b->active[i] = 0;
+                    large->active[largeHit] = 0;
+                    
+                    // Large hits split, which needs the scalar spawner
+                    batchSpawnSmallAsteroid(batch, game, large->x[largeHit], large->y[largeHit], large->vx[largeHit],
+                                            large->vy[largeHit]);
+                    batchSpawnSmallAsteroid(batch, game, large->x[largeHit], large->y[largeHit], large->vx[largeHit],
+                                            large->vy[largeHit]);
+                }
+                else if(smallHit >= 0)
+                {
+                    b->active[i] = 0;
+                    small->active[smallHit] = 0;
+                }
+            }
+        }
+        
+        count = large->slotCount * lanes;
+        for(int i = 0;
+            i < count;
+            i++)
+        {
+            large->hit[i] = 0;
+        }
+        count = small->slotCount * lanes;
+        for(int i = 0;
+            i < count;
+            i++)
+        {
+            small->hit[i] = 0;
+        }
+    }
+    
+    // Check for asteroid player collisions
+    batchCollideShip(batch, &batch->largeAsteroids);
+    batchCollideShip(batch, &batch->smallAsteroids);
+    
+    // Restart finished games in place
+    for(int game = 0;
+        game < batch->gameCount;
+        game++)
+    {
+        if(batch->gameOver[game])
+        {
+            batchResetGame(batch, game, batchRandomNext(&batch->random, game));
+            batch->gamesFinished++;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#if !defined(ASTEROIDS_BATCH_H)
+#define ASTEROIDS_BATCH_H
+
+// NOTE(trist007): Batched simulation of many independent games for bot
+// evaluation. Same rules as GameUpdate with the default config (no swept
+// collision, no wrapping world), except a bullet torn between two equally
+// near asteroids goes by slot rather than handle. The state is transposed:
+// every per game value is an array with one lane per game, and every entity
+// slot is a row of lanes, so the movement and collision loops run across
+// games and vectorise. Only the rare branchy work (firing, spawning, splitting)
+// drops down to one game at a time.
+
+// Lane count gets rounded up to this so rows stay SIMD and cache line sized
+#define BATCH_LANE_WIDTH 8
+
+// Upper bound on asteroid slots per game, sizes the collision pass scratch
+#define BATCH_MAX_SLOTS 64
+
+// Entity rows, indexed [slot * laneCount + game]
+typedef struct
+{
+    int slotCount;
+    float *x;
+    float *y;
+    float *vx;
+    float *vy;
+    int *active;
+    int *hit;
+} BatchBullets;
+
+typedef struct
+{
+    int slotCount;
+    float *x;
+    float *y;
+    float *vx;
+    float *vy;
+    float *size;
+    int *active;
+    int *hit;
+} BatchAsteroids;
+
+// Per lane xoshiro128+ state, same generator as RandomSeries so a lane draws
+// the same numbers a GameState with the same seed would
+typedef struct
+{
+    unsigned int *s0;
+    unsigned int *s1;
+    unsigned int *s2;
+    unsigned int *s3;
+} BatchRandom;
+
+typedef struct
+{
+    int gameCount;
+    int laneCount;
+    
+    // Tunables shared by every game, taken from a freshly initialized GameState
+    GameState rules;
+    
+    // Per game, indexed [game]
+    float *shipX;
+    float *shipY;
+    float *shipVX;
+    float *shipVY;
+    float *shipRotation;
+    float *asteroidSpeedMultiplier;
+    float *gameTimer;
+    float *asteroidSpawnTimer;
+    int *gameOver;
+    
+    BatchRandom random;
+    
+    // Large asteroid spawn scratch, filled for every lane at once
+    int *spawnSlot;
+    unsigned int *spawnAngle;
+    unsigned int *spawnSize;
+    
+    BatchBullets bullets;
+    BatchAsteroids largeAsteroids;
+    BatchAsteroids smallAsteroids;
+    
+    // Finished games are restarted in place, this counts them
+    long long gamesFinished;
+} GameBatch;
+
+GameBatch *initializeGameBatch(Arena *arena, int gameCount, unsigned long long seed);
+unsigned int batchRandomNext(BatchRandom *random, int game);
+void batchRandomFill(BatchRandom *random, int *mask, unsigned int *out, int laneCount);
+void GameBatchUpdate(GameBatch *batch, GameInput *inputs, float dt);
+
+#endif
@@ -0,0 +1,534 @@
+#include "asteroids_raster.h"
+
+// Pixels per store in rasterFillSpan, picked at compile time like the
+// narrowphase
+#if defined(__AVX2__)
+#define RASTER_LANES 8
+#elif defined(__SSE2__) || defined(_M_X64)
+#define RASTER_LANES 4
+#else
+#define RASTER_LANES 1
+#endif
+
+// 5x7 glyphs, one byte per row, the high of the 5 bits on the left
+static const unsigned char rasterDigitGlyphs[10][RASTER_GLYPH_HEIGHT] =
+{
+    { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E },
+    { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F },
+    { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },
+    { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 },
+    { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },
+    { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E },
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },
+    { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E },
+    { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C },
+};
+
+static const unsigned char rasterLetterGlyphs[26][RASTER_GLYPH_HEIGHT] =
+{
+    { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },
+    { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E },
+    { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E },
+    { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C },
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F },
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 },
+    { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F },
+    { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },
+    { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E },
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C },
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F },
+    { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 },
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },
+    { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },
+    { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 },
+    { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D },
+    { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 },
+    { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E },
+    { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 },
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A },
+    { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 },
+    { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 },
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F },
+};
+
+static const unsigned char rasterPeriodGlyph[RASTER_GLYPH_HEIGHT] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C };
+static const unsigned char rasterColonGlyph[RASTER_GLYPH_HEIGHT] = { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 };
+static const unsigned char rasterDashGlyph[RASTER_GLYPH_HEIGHT] = { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 };
+
+// 0 for anything the font doesn't have, spaces included
+static const unsigned char *
+rasterGlyph(char c)
+{
+    const unsigned char *result = 0;
+    if(c >= 'a' && c <= 'z') c = c - 'a' + 'A';
+    if(c >= 'A' && c <= 'Z') result = rasterLetterGlyphs[c - 'A'];
+    else if(c >= '0' && c <= '9') result = rasterDigitGlyphs[c - '0'];
+    else if(c == '.') result = rasterPeriodGlyph;
+    else if(c == ':') result = rasterColonGlyph;
+    else if(c == '-') result = rasterDashGlyph;
+    return(result);
+}
+
+static unsigned int
+rasterPackColor(Color color)
+{
+    unsigned int result = (unsigned int)color.r | ((unsigned int)color.g << 8) |
+                          ((unsigned int)color.b << 16) | ((unsigned int)color.a << 24);
+    return(result);
+}
+
+bool
+pushFramebuffer(Arena *arena, Framebuffer *buffer, int width, int height)
+{
+    buffer->width = width;
+    buffer->height = height;
+    buffer->pitch = width * 4;
+    buffer->pixels = arena_push_array(arena, unsigned char, (size_t)buffer->pitch * height);
+    return(buffer->pixels != 0);
+}
+
+// Tile rectangle, max exclusive
+typedef struct
+{
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+} RasterRect;
+
+// [x0, x1) of row y, already clipped
+static long long
+rasterFillSpan(Framebuffer *target, int y, int x0, int x1, unsigned int color)
+{
+    unsigned int *row = (unsigned int *)(target->pixels + (size_t)y * target->pitch);
+    int x = x0;
+#if RASTER_LANES == 8
+    __m256i wide = _mm256_set1_epi32((int)color);
+    for(;
+        x + 8 <= x1;
+        x += 8)
+    {
+        _mm256_storeu_si256((__m256i *)(row + x), wide);
+    }
+#elif RASTER_LANES == 4
+    __m128i wide = _mm_set1_epi32((int)color);
+    for(;
+        x + 4 <= x1;
+        x += 4)
+    {
+        _mm_storeu_si128((__m128i *)(row + x), wide);
+    }
+#endif
+    for(;
+        x < x1;
+        x++)
+    {
+        row[x] = color;
+    }
+    return(x1 > x0 ? x1 - x0 : 0);
+}
+
+static long long
+rasterFillRect(Framebuffer *target, RasterRect *clip, int minX, int minY, int maxX, int maxY, unsigned int color)
+{
+    if(minX < clip->minX) minX = clip->minX;
+    if(minY < clip->minY) minY = clip->minY;
+    if(maxX > clip->maxX) maxX = clip->maxX;
+    if(maxY > clip->maxY) maxY = clip->maxY;
+    
+    long long written = 0;
+    for(int y = minY;
+        y < maxY;
+        y++)
+    {
+        written += rasterFillSpan(target, y, minX, maxX, color);
+    }
+    return(written);
+}
+
+// Pixel centers within the radius. Each row's span only depends on the
+// circle, so a circle split across tiles meets itself exactly.
+static long long
+rasterCircle(Framebuffer *target, RasterRect *clip, Vector2 center, float radius, Color circleColor)
+{
+    float cx = center.x;
+    float cy = center.y;
+    float r = radius;
+    float r2 = r * r;
+    unsigned int color = rasterPackColor(circleColor);
+    
+    int minY = (int)floorf(cy - r);
+    int maxY = (int)ceilf(cy + r) + 1;
+    if(minY < clip->minY) minY = clip->minY;
+    if(maxY > clip->maxY) maxY = clip->maxY;
+    
+    long long written = 0;
+    for(int y = minY;
+        y < maxY;
+        y++)
+    {
+        float dy = (y + 0.5f) - cy;
+        float h2 = r2 - dy * dy;
+        if(h2 > 0)
+        {
+            float half = sqrtf(h2);
+            int x0 = (int)ceilf(cx - half - 0.5f);
+            int x1 = (int)floorf(cx + half - 0.5f) + 1;
+            if(x0 < clip->minX) x0 = clip->minX;
+            if(x1 > clip->maxX) x1 = clip->maxX;
+            written += rasterFillSpan(target, y, x0, x1, color);
+        }
+    }
+    return(written);
+}
+
+// Either winding. A row's span runs between where its center line crosses
+// the edges.
+static long long
+rasterTriangle(Framebuffer *target, RasterRect *clip, RenderTriangle *triangle)
+{
+    Vector2 v[3] = { triangle->v1, triangle->v2, triangle->v3 };
+    unsigned int color = rasterPackColor(triangle->color);
+    
+    float top = fminf(v[0].y, fminf(v[1].y, v[2].y));
+    float bottom = fmaxf(v[0].y, fmaxf(v[1].y, v[2].y));
+    int minY = (int)floorf(top);
+    int maxY = (int)ceilf(bottom) + 1;
+    if(minY < clip->minY) minY = clip->minY;
+    if(maxY > clip->maxY) maxY = clip->maxY;
+    
+    long long written = 0;
+    for(int y = minY;
+        y < maxY;
+        y++)
+    {
+        float py = y + 0.5f;
+        float left = 1e30f;
+        float right = -1e30f;
+        for(int e = 0;
+            e < 3;
+            e++)
+        {
+            Vector2 a = v[e];
+            Vector2 b = v[(e + 1) % 3];
+            if((a.y <= py && py < b.y) || (b.y <= py && py < a.y))
+            {
+                float x = a.x + (py - a.y) * (b.x - a.x) / (b.y - a.y);
+                left = fminf(left, x);
+                right = fmaxf(right, x);
+            }
+        }
+        
+        if(left <= right)
+        {
+            int x0 = (int)ceilf(left - 0.5f);
+            int x1 = (int)ceilf(right - 0.5f);
+            if(x0 < clip->minX) x0 = clip->minX;
+            if(x1 > clip->maxX) x1 = clip->maxX;
+            written += rasterFillSpan(target, y, x0, x1, color);
+        }
+    }
+    return(written);
+}
+
+// One pixel per step along the longer axis
+static long long
+rasterLine(Framebuffer *target, RasterRect *clip, RenderLine *line)
+{
+    unsigned int color = rasterPackColor(line->color);
+    float dx = line->to.x - line->from.x;
+    float dy = line->to.y - line->from.y;
+    int steps = (int)ceilf(fmaxf(fabsf(dx), fabsf(dy)));
+    if(steps < 1) steps = 1;
+    
+    long long written = 0;
+    for(int i = 0;
+        i <= steps;
+        i++)
+    {
+        float t = (float)i / steps;
+        int x = (int)floorf(line->from.x + dx * t);
+        int y = (int)floorf(line->from.y + dy * t);
+        if(x >= clip->minX && x < clip->maxX && y >= clip->minY && y < clip->maxY)
+        {
+            unsigned int *row = (unsigned int *)(target->pixels + (size_t)y * target->pitch);
+            row[x] = color;
+            written++;
+        }
+    }
+    return(written);
+}
+
+static int
+rasterTextScale(RenderText *text)
+{
+    int result = text->fontSize / 10;
+    if(result < 1) result = 1;
+    return(result);
+}
+
+static long long
+rasterText(Framebuffer *target, RasterRect *clip, RenderText *text)
+{
+    unsigned int color = rasterPackColor(text->color);
+    int scale = rasterTextScale(text);
+    const char *chars = renderTextChars(text);
+    
+    long long written = 0;
+    for(int c = 0;
+        c < text->length;
+        c++)
+    {
+        const unsigned char *glyph = rasterGlyph(chars[c]);
+        int left = text->x + c * (RASTER_GLYPH_WIDTH + 1) * scale;
+        if(glyph && left < clip->maxX && left + RASTER_GLYPH_WIDTH * scale > clip->minX)
+        {
+            for(int row = 0;
+                row < RASTER_GLYPH_HEIGHT;
+                row++)
+            {
+                int y = text->y + row * scale;
+                for(int col = 0;
+                    col < RASTER_GLYPH_WIDTH;
+                    col++)
+                {
+                    if(glyph[row] & (0x10 >> col))
+                    {
+                        int x = left + col * scale;
+                        written += rasterFillRect(target, clip, x, y, x + scale, y + scale, color);
+                    }
+                }
+            }
+        }
+    }
+    return(written);
+}
+
+// Float bounds clipped to the target and rounded out to whole pixels. False
+// when nothing is left.
+static bool
+rasterClipBounds(Framebuffer *target, float minX, float minY, float maxX, float maxY, RasterRect *bounds)
+{
+    minX = fmaxf(minX, 0);
+    minY = fmaxf(minY, 0);
+    maxX = fminf(maxX, (float)target->width);
+    maxY = fminf(maxY, (float)target->height);
+    bounds->minX = (int)floorf(minX);
+    bounds->minY = (int)floorf(minY);
+    bounds->maxX = (int)ceilf(maxX);
+    bounds->maxY = (int)ceilf(maxY);
+    return(bounds->minX < bounds->maxX && bounds->minY < bounds->maxY);
+}
+
+static bool
+rasterCircleBounds(Framebuffer *target, Vector2 center, float radius, RasterRect *bounds)
+{
+    return(rasterClipBounds(target, center.x - radius, center.y - radius, center.x + radius + 1,
+                            center.y + radius + 1, bounds));
+}
+
+// Pixel bounds of a command, max exclusive. False when it draws nothing.
+// Instance batches are binned an instance at a time, not through here.
+static bool
+rasterCommandBounds(RenderCommandHeader *header, Framebuffer *target, RasterRect *bounds)
+{
+    float minX = 0;
+    float minY = 0;
+    float maxX = (float)target->width;
+    float maxY = (float)target->height;
+    if(header->type == RENDER_CIRCLE)
+    {
+        RenderCircle *circle = (RenderCircle *)(header + 1);
+        return(rasterCircleBounds(target, circle->center, circle->radius, bounds));
+    }
+    else if(header->type == RENDER_TRIANGLE)
+    {
+        RenderTriangle *triangle = (RenderTriangle *)(header + 1);
+        minX = fminf(triangle->v1.x, fminf(triangle->v2.x, triangle->v3.x));
+        minY = fminf(triangle->v1.y, fminf(triangle->v2.y, triangle->v3.y));
+        maxX = fmaxf(triangle->v1.x, fmaxf(triangle->v2.x, triangle->v3.x)) + 1;
+        maxY = fmaxf(triangle->v1.y, fmaxf(triangle->v2.y, triangle->v3.y)) + 1;
+    }
+    else if(header->type == RENDER_LINE)
+    {
+        RenderLine *line = (RenderLine *)(header + 1);
+        minX = fminf(line->from.x, line->to.x);
+        minY = fminf(line->from.y, line->to.y);
+        maxX = fmaxf(line->from.x, line->to.x) + 1;
+        maxY = fmaxf(line->from.y, line->to.y) + 1;
+    }
+    else if(header->type == RENDER_TEXT)
+    {
+        RenderText *text = (RenderText *)(header + 1);
+        int scale = rasterTextScale(text);
+        minX = (float)text->x;
+        minY = (float)text->y;
+        maxX = (float)(text->x + text->length * (RASTER_GLYPH_WIDTH + 1) * scale);
+        maxY = (float)(text->y + RASTER_GLYPH_HEIGHT * scale);
+    }
+    return(rasterClipBounds(target, minX, minY, maxX, maxY, bounds));
+}
+
+// Tiles a command's bounds cover, max exclusive
+static RasterRect
+rasterTileSpan(RasterRect *bounds)
+{
+    RasterRect result;
+    result.minX = bounds->minX / RASTER_TILE_SIZE;
+    result.minY = bounds->minY / RASTER_TILE_SIZE;
+    result.maxX = (bounds->maxX - 1) / RASTER_TILE_SIZE + 1;
+    result.maxY = (bounds->maxY - 1) / RASTER_TILE_SIZE + 1;
+    return(result);
+}
+
+// Adds offset to every tile bounds covers, or just counts it when there is
+// no binOffset yet
+static void
+rasterBin(RasterFrame *frame, int *binFill, RasterRect *bounds, unsigned int offset)
+{
+    RasterRect tiles = rasterTileSpan(bounds);
+    for(int ty = tiles.minY;
+        ty < tiles.maxY;
+        ty++)
+    {
+        for(int tx = tiles.minX;
+            tx < tiles.maxX;
+            tx++)
+        {
+            int *fill = binFill + ty * frame->tileCols + tx;
+            if(frame->binOffset) frame->binOffset[*fill] = offset;
+            (*fill)++;
+        }
+    }
+}
+
+// NOTE(trist007): a batch can cover the whole screen, binning it whole would
+// have every tile walk every instance in it. Each instance goes into the
+// bins it touches on its own instead, with its offset flagged.
+static void
+rasterBinCommands(RasterFrame *frame, int *binFill)
+{
+    RenderCommands *commands = frame->commands;
+    for(RenderCommandHeader *header = firstRenderCommand(commands);
+        header;
+        header = nextRenderCommand(commands, header))
+    {
+        RasterRect bounds;
+        if(header->type == RENDER_CIRCLE_INSTANCES)
+        {
+            RenderCircleInstances *instances = (RenderCircleInstances *)(header + 1);
+            RenderInstance *instance = renderInstances(instances);
+            for(int i = 0;
+                i < instances->count;
+                i++, instance++)
+            {
+                if(rasterCircleBounds(frame->target, instance->center, instance->radius, &bounds))
+                {
+                    unsigned int offset = (unsigned int)((unsigned char *)instance - commands->base);
+                    rasterBin(frame, binFill, &bounds, offset | RASTER_BIN_INSTANCE);
+                }
+            }
+        }
+        else if(rasterCommandBounds(header, frame->target, &bounds))
+        {
+            rasterBin(frame, binFill, &bounds, (unsigned int)((unsigned char *)header - commands->base));
+        }
+    }
+}
+
+// Bins the commands into tiles, counting first so every bin is one run of
+// binOffset. False when the bins don't fit in arena.
+bool
+beginRasterFrame(RasterFrame *frame, Arena *arena, RenderCommands *commands, Framebuffer *target)
+{
+    frame->commands = commands;
+    frame->target = target;
+    frame->tileCols = (target->width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    frame->tileRows = (target->height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    frame->tileCount = frame->tileCols * frame->tileRows;
+    frame->binStart = arena_push_array(arena, int, frame->tileCount + 1);
+    frame->binOffset = 0;
+    int *binFill = arena_push_array(arena, int, frame->tileCount);
+    if(!frame->binStart || !binFill) return(false);
+    memset(binFill, 0, frame->tileCount * sizeof(int));
+    
+    rasterBinCommands(frame, binFill);
+    
+    int total = 0;
+    for(int t = 0;
+        t < frame->tileCount;
+        t++)
+    {
+        frame->binStart[t] = total;
+        total += binFill[t];
+        binFill[t] = frame->binStart[t];
+    }
+    frame->binStart[frame->tileCount] = total;
+    
+    frame->binOffset = arena_push_array(arena, unsigned int, total);
+    if(!frame->binOffset) return(false);
+    
+    rasterBinCommands(frame, binFill);
+    return(true);
+}
+
+// Draws everything binned to the tile, in push order. Safe to call for
+// different tiles from different threads. Returns the pixels written,
+// overdraw included.
+long long
+rasterizeTile(RasterFrame *frame, int tile)
+{
+    Framebuffer *target = frame->target;
+    RasterRect clip;
+    clip.minX = (tile % frame->tileCols) * RASTER_TILE_SIZE;
+    clip.minY = (tile / frame->tileCols) * RASTER_TILE_SIZE;
+    clip.maxX = clip.minX + RASTER_TILE_SIZE;
+    clip.maxY = clip.minY + RASTER_TILE_SIZE;
+    if(clip.maxX > target->width) clip.maxX = target->width;
+    if(clip.maxY > target->height) clip.maxY = target->height;
+    
+    long long written = 0;
+    for(int b = frame->binStart[tile];
+        b < frame->binStart[tile + 1];
+        b++)
+    {
+        unsigned int offset = frame->binOffset[b];
+        unsigned char *entry = frame->commands->base + (offset & ~RASTER_BIN_INSTANCE);
+        RenderCommandHeader *header = (RenderCommandHeader *)entry;
+        if(offset & RASTER_BIN_INSTANCE)
+        {
+            // The mesh only stands in for a circle, the exact one is cheaper
+            // here and rotation doesn't change it
+            RenderInstance *instance = (RenderInstance *)entry;
+            written += rasterCircle(target, &clip, instance->center, instance->radius, instance->color);
+        }
+        else if(header->type == RENDER_CLEAR)
+        {
+            RenderClear *clear = (RenderClear *)(header + 1);
+            written += rasterFillRect(target, &clip, clip.minX, clip.minY, clip.maxX, clip.maxY,
+                                      rasterPackColor(clear->color));
+        }
+        else if(header->type == RENDER_CIRCLE)
+        {
+            RenderCircle *circle = (RenderCircle *)(header + 1);
+            written += rasterCircle(target, &clip, circle->center, circle->radius, circle->color);
+        }
+        else if(header->type == RENDER_TRIANGLE)
+        {
+            written += rasterTriangle(target, &clip, (RenderTriangle *)(header + 1));
+        }
+        else if(header->type == RENDER_LINE)
+        {
+            written += rasterLine(target, &clip, (RenderLine *)(header + 1));
+        }
+        else if(header->type == RENDER_TEXT)
+        {
+            written += rasterText(target, &clip, (RenderText *)(header + 1));
+        }
+    }
+    return(written);
+}
@@ -0,0 +1,56 @@
+#if !defined(ASTEROIDS_RASTER_H)
+#define ASTEROIDS_RASTER_H
+
+// NOTE(trist007): Software backend for render commands, for headless runs
+// and machines without a GPU. The screen is cut into RASTER_TILE_SIZE
+// tiles. beginRasterFrame bins every command into the tiles it touches,
+// keeping them in push order, and then each tile can be rasterised on its
+// own. Tiles never share pixels, so the platform can hand them to as many
+// threads as it likes and the frame comes out the same.
+//
+// Shapes are filled a row at a time: a row's span gets worked out from the
+// shape alone, then clipped to the tile and filled SIMD wide. Pixels count
+// as covered when their center is inside. Colors are written as they are,
+// there is no blending. Text uses a built in 5x7 font scaled up by whole
+// pixels, lowercase comes out as uppercase.
+
+#define RASTER_TILE_SIZE 64
+
+// Set on a binOffset that points at a RenderInstance instead of a command
+#define RASTER_BIN_INSTANCE 0x80000000u
+
+// Glyph cell at fontSize 10, one pixel apart. platformMeasureText on a
+// headless build should agree with it.
+#define RASTER_GLYPH_WIDTH 5
+#define RASTER_GLYPH_HEIGHT 7
+
+// RGBA, 4 bytes a pixel in that order
+typedef struct
+{
+    unsigned char *pixels;
+    int width;
+    int height;
+    int pitch; // bytes per row
+} Framebuffer;
+
+typedef struct
+{
+    RenderCommands *commands;
+    Framebuffer *target;
+    
+    int tileCols;
+    int tileRows;
+    int tileCount;
+    
+    // Offsets of the commands touching tile t, from commands->base, are
+    // binOffset[binStart[t]] up to binOffset[binStart[t + 1]]. Instances
+    // of a batch get binned one by one, see RASTER_BIN_INSTANCE.
+    int *binStart;
+    unsigned int *binOffset;
+} RasterFrame;
+
+bool pushFramebuffer(Arena *arena, Framebuffer *buffer, int width, int height);
+bool beginRasterFrame(RasterFrame *frame, Arena *arena, RenderCommands *commands, Framebuffer *target);
+long long rasterizeTile(RasterFrame *frame, int tile);
+
+#endif
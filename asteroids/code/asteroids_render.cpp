@@ -0,0 +1,420 @@
+#include "asteroids_render.h"
+
+#include <string.h>
+
+// The list grows in place at the top of arena, nothing else may be pushed
+// there until the frame has been drawn
+void
+beginRenderCommands(RenderCommands *commands, Arena *arena, int width, int height)
+{
+    *commands = {};
+    commands->arena = arena;
+    commands->base = arena_push_array(arena, unsigned char, 0);
+    commands->width = width;
+    commands->height = height;
+}
+
+// Every command is a multiple of 4 bytes so the floats in the next one stay
+// aligned. Returns the body after the header, 0 when the arena is full and
+// the command got dropped.
+static void *
+pushRenderCommand(RenderCommands *commands, int type, size_t bodySize)
+{
+    void *result = 0;
+    size_t size = (sizeof(RenderCommandHeader) + bodySize + 3) & ~(size_t)3;
+    RenderCommandHeader *header = (RenderCommandHeader *)arena_alloc(commands->arena, size);
+    if(header)
+    {
+        Assert((unsigned char *)header == commands->base + commands->used);
+        header->type = (unsigned short)type;
+        header->size = (unsigned short)size;
+        commands->used += size;
+        commands->count++;
+        commands->typeCount[type]++;
+        commands->openInstances = 0;
+        result = header + 1;
+    }
+    else
+    {
+        commands->dropped++;
+    }
+    return(result);
+}
+
+void
+pushClear(RenderCommands *commands, Color color)
+{
+    RenderClear *clear = (RenderClear *)pushRenderCommand(commands, RENDER_CLEAR, sizeof(RenderClear));
+    if(clear) clear->color = color;
+}
+
+void
+pushCircle(RenderCommands *commands, Vector2 center, float radius, Color color)
+{
+    RenderCircle *circle = (RenderCircle *)pushRenderCommand(commands, RENDER_CIRCLE, sizeof(RenderCircle));
+    if(circle)
+    {
+        circle->center = center;
+        circle->radius = radius;
+        circle->color = color;
+    }
+}
+
+void
+pushTriangle(RenderCommands *commands, Vector2 v1, Vector2 v2, Vector2 v3, Color color)
+{
+    RenderTriangle *triangle = (RenderTriangle *)pushRenderCommand(commands, RENDER_TRIANGLE, sizeof(RenderTriangle));
+    if(triangle)
+    {
+        triangle->v1 = v1;
+        triangle->v2 = v2;
+        triangle->v3 = v3;
+        triangle->color = color;
+    }
+}
+
+void
+pushLine(RenderCommands *commands, Vector2 from, Vector2 to, Color color)
+{
+    RenderLine *line = (RenderLine *)pushRenderCommand(commands, RENDER_LINE, sizeof(RenderLine));
+    if(line)
+    {
+        line->from = from;
+        line->to = to;
+        line->color = color;
+    }
+}
+
+void
+pushText(RenderCommands *commands, const char *text, int x, int y, int fontSize, Color color)
+{
+    int length = (int)strlen(text);
+    if(length > RENDER_MAX_TEXT) length = RENDER_MAX_TEXT;
+    
+    RenderText *entry = (RenderText *)pushRenderCommand(commands, RENDER_TEXT, sizeof(RenderText) + length);
+    if(entry)
+    {
+        entry->x = x;
+        entry->y = y;
+        entry->fontSize = fontSize;
+        entry->color = color;
+        entry->length = length;
+        memcpy(entry + 1, text, length);
+    }
+}
+
+// Appends to the open batch while it has room, so a run of instances with
+// nothing pushed in between ends up in as few commands as it can
+void
+pushCircleInstance(RenderCommands *commands, Vector2 center, float radius, float rotation, Color color)
+{
+    RenderInstance *instance = 0;
+    RenderCommandHeader *header = commands->openInstances;
+    if(header)
+    {
+        instance = (RenderInstance *)arena_alloc(commands->arena, sizeof(RenderInstance));
+        if(instance)
+        {
+            Assert((unsigned char *)instance == commands->base + commands->used);
+            header->size = (unsigned short)(header->size + sizeof(RenderInstance));
+            commands->used += sizeof(RenderInstance);
+        }
+        else
+        {
+            commands->dropped++;
+        }
+    }
+    else
+    {
+        RenderCircleInstances *instances = (RenderCircleInstances *)pushRenderCommand(
+            commands, RENDER_CIRCLE_INSTANCES, sizeof(RenderCircleInstances) + sizeof(RenderInstance));
+        if(instances)
+        {
+            instances->count = 0;
+            instance = renderInstances(instances);
+            commands->openInstances = (RenderCommandHeader *)instances - 1;
+        }
+    }
+    
+    if(instance)
+    {
+        instance->center = center;
+        instance->radius = radius;
+        instance->rotation = rotation;
+        instance->color = color;
+        commands->instanceCount++;
+        
+        RenderCircleInstances *instances = (RenderCircleInstances *)(commands->openInstances + 1);
+        instances->count++;
+        if(instances->count == RENDER_MAX_INSTANCES) commands->openInstances = 0;
+    }
+}
+
+RenderCommandHeader *
+firstRenderCommand(RenderCommands *commands)
+{
+    RenderCommandHeader *result = 0;
+    if(commands->used) result = (RenderCommandHeader *)commands->base;
+    return(result);
+}
+
+RenderCommandHeader *
+nextRenderCommand(RenderCommands *commands, RenderCommandHeader *header)
+{
+    RenderCommandHeader *result = 0;
+    unsigned char *next = (unsigned char *)header + header->size;
+    if(next < commands->base + commands->used) result = (RenderCommandHeader *)next;
+    return(result);
+}
+
+const char *
+renderTextChars(RenderText *text)
+{
+    return((const char *)(text + 1));
+}
+
+RenderInstance *
+renderInstances(RenderCircleInstances *instances)
+{
+    return((RenderInstance *)(instances + 1));
+}
+
+void
+buildCircleMesh(RenderCircleMesh *mesh)
+{
+    for(int i = 0;
+        i < RENDER_CIRCLE_SEGMENTS;
+        i++)
+    {
+        float angle = (2.0f * PI * i) / RENDER_CIRCLE_SEGMENTS;
+        mesh->vertex[i].x = cosf(angle);
+        mesh->vertex[i].y = sinf(angle);
+    }
+}
+
+// One draw call per command, vertices as a GPU backend sends them: a fan per
+// circle, the mesh's triangles per instance and a quad per character
+void
+countRenderDraw(RenderDrawStats *stats, RenderCommandHeader *header)
+{
+    stats->drawCalls++;
+    if(header->type == RENDER_CIRCLE)
+    {
+        stats->vertices += RENDER_FAN_CIRCLE_VERTICES;
+    }
+    else if(header->type == RENDER_TRIANGLE)
+    {
+        stats->vertices += 3;
+    }
+    else if(header->type == RENDER_LINE)
+    {
+        stats->vertices += 2;
+    }
+    else if(header->type == RENDER_TEXT)
+    {
+        stats->vertices += 4 * ((RenderText *)(header + 1))->length;
+    }
+    else if(header->type == RENDER_CIRCLE_INSTANCES)
+    {
+        stats->vertices += (long long)((RenderCircleInstances *)(header + 1))->count * RENDER_CIRCLE_SEGMENTS * 3;
+    }
+}
+
+// Ship as a filled triangle with an outline
+static void
+pushShip(RenderCommands *commands, Ship *ship, Vector2 pos, float rotation)
+{
+    Vector2 v1 = {
+        pos.x + sinf(rotation) * ship->size,
+        pos.y - cosf(rotation) * ship->size
+    };
+    
+    Vector2 v2 = {
+        pos.x + sinf(rotation + 2.4f) * ship->size,
+        pos.y - cosf(rotation + 2.4f) * ship->size
+    };
+    
+    Vector2 v3 = {
+        pos.x + sinf(rotation - 2.4f) * ship->size,
+        pos.y - cosf(rotation - 2.4f) * ship->size
+    };
+    
+    pushTriangle(commands, v1, v3, v2, ship->color);
+    pushLine(commands, v1, v3, BLACK);
+    pushLine(commands, v3, v2, BLACK);
+    pushLine(commands, v2, v1, BLACK);
+}
+
+bool
+pushRenderState(Arena *arena, RenderState *state, GameConfig *config)
+{
+    int slots = ASTEROID_POOL_SLOTS(config->largeAsteroidCapacity + config->smallAsteroidCapacity);
+    *state = {};
+    state->bulletPos = arena_push_array(arena, Vector2, config->bulletCapacity);
+    state->bulletPrevPos = arena_push_array(arena, Vector2, config->bulletCapacity);
+    state->x = arena_push_array(arena, float, slots);
+    state->y = arena_push_array(arena, float, slots);
+    state->prevX = arena_push_array(arena, float, slots);
+    state->prevY = arena_push_array(arena, float, slots);
+    state->radius = arena_push_array(arena, float, slots);
+    return(state->bulletPos && state->bulletPrevPos && state->x && state->y && state->prevX && state->prevY &&
+           state->radius);
+}
+
+// The game's pools have to be the size the state was pushed for
+void
+captureRenderState(GameState *gs, RenderState *state)
+{
+    state->config = gs->config;
+    state->ship = gs->ship;
+    state->gameOver = gs->gameOver;
+    
+    BulletPool *bullets = &gs->bullets;
+    int bulletCount = 0;
+    for(int word = 0;
+        word < bullets->maskWords;
+        word++)
+    {
+        unsigned long long bits = bullets->activeMask[word];
+        while(bits)
+        {
+            int i = word * 64 + findLeastSignificantSetBit(bits);
+            bits &= bits - 1;
+            state->bulletPos[bulletCount] = bullets->bullet[i].pos;
+            state->bulletPrevPos[bulletCount] = bullets->bullet[i].prevPos;
+            bulletCount++;
+        }
+    }
+    state->bulletCount = bulletCount;
+    
+    AsteroidPool *asteroids = &gs->asteroids;
+    size_t bytes = asteroids->count * sizeof(float);
+    memcpy(state->x, asteroids->x, bytes);
+    memcpy(state->y, asteroids->y, bytes);
+    memcpy(state->prevX, asteroids->prevX, bytes);
+    memcpy(state->prevY, asteroids->prevY, bytes);
+    memcpy(state->radius, asteroids->radius, bytes);
+    state->asteroidCount = asteroids->count;
+}
+
+static long
+renderAtomicExchange(volatile long *value, long newValue)
+{
+#if defined(_MSC_VER)
+    return(_InterlockedExchange(value, newValue));
+#else
+    return(__atomic_exchange_n(value, newValue, __ATOMIC_ACQ_REL));
+#endif
+}
+
+static long
+renderAtomicLoad(volatile long *value)
+{
+#if defined(_MSC_VER)
+    return(*value);
+#else
+    return(__atomic_load_n(value, __ATOMIC_ACQUIRE));
+#endif
+}
+
+bool
+pushRenderStateBuffer(Arena *arena, RenderStateBuffer *buffer, GameConfig *config)
+{
+    bool result = true;
+    for(int i = 0;
+        i < 3;
+        i++)
+    {
+        result = result && pushRenderState(arena, buffer->slots + i, config);
+    }
+    buffer->front = 0;
+    buffer->middle = 1;
+    buffer->back = 2;
+    return(result);
+}
+
+// Writer only. The slot stays the writer's until publishRenderState.
+RenderState *
+beginRenderStateWrite(RenderStateBuffer *buffer)
+{
+    return(buffer->slots + buffer->back);
+}
+
+// Writer only
+void
+publishRenderState(RenderStateBuffer *buffer)
+{
+    buffer->back = (int)(renderAtomicExchange(&buffer->middle, buffer->back | RENDER_STATE_FRESH) & 3);
+}
+
+// Reader only. The newest published state, or the one from last time when
+// nothing new came in (fresh says which). Stays put until the next call.
+RenderState *
+acquireRenderState(RenderStateBuffer *buffer, bool *fresh)
+{
+    *fresh = (renderAtomicLoad(&buffer->middle) & RENDER_STATE_FRESH) != 0;
+    if(*fresh)
+    {
+        // Only the writer touches it in between, and it only ever puts a
+        // fresh one back
+        buffer->front = (int)(renderAtomicExchange(&buffer->middle, buffer->front) & 3);
+    }
+    return(buffer->slots + buffer->front);
+}
+
+// The frame alpha of the way from the previous tick to the current one
+void
+GameRender(RenderState *state, RenderCommands *commands, float alpha)
+{
+    pushClear(commands, RAYWHITE);
+    
+    // NOTE(trist007): across a seam of the wrapping world the interpolated
+    // position can be off screen, and anything that pokes over an edge shows
+    // up on the opposite one too. Every image of it gets drawn.
+    Vector2 offset[WRAP_MAX_IMAGES];
+    Vector2 shipPos = Vector2Lerp(state->ship.prevPos, state->ship.pos, alpha);
+    float shipRotation = Lerp(state->ship.prevRotation, state->ship.rotation, alpha);
+    int imageCount = wrapImages(&state->config, shipPos, state->ship.size, offset);
+    for(int m = 0;
+        m < imageCount;
+        m++)
+    {
+        pushShip(commands, &state->ship, Vector2Add(shipPos, offset[m]), shipRotation);
+    }
+    
+    for(int i = 0;
+        i < state->bulletCount;
+        i++)
+    {
+        pushCircle(commands, Vector2Lerp(state->bulletPrevPos[i], state->bulletPos[i], alpha), 3.0f, RED);
+    }
+    
+    // NOTE(trist007): asteroids are by far the most of a frame, they go out
+    // as instances of one mesh. They don't spin in the sim yet so the
+    // rotation is always 0.
+    for(int i = 0;
+        i < state->asteroidCount;
+        i++)
+    {
+        Vector2 pos = { Lerp(state->prevX[i], state->x[i], alpha), Lerp(state->prevY[i], state->y[i], alpha) };
+        imageCount = wrapImages(&state->config, pos, state->radius[i], offset);
+        for(int m = 0;
+            m < imageCount;
+            m++)
+        {
+            pushCircleInstance(commands, Vector2Add(pos, offset[m]), state->radius[i], 0.0f, GRAY);
+        }
+    }
+    
+    if(state->gameOver)
+    {
+        int fontSize = 80;
+        int fontSize2 = 50;
+        const char *text = "GAME OVER";
+        const char *text2 = "hit R to restart";
+        int textWidth = platformMeasureText(text, fontSize);
+        pushText(commands, text, commands->width / 2 - textWidth / 2, commands->height / 2 - fontSize / 2, fontSize, RED);
+        pushText(commands, text2, commands->width / 2 - textWidth / 2, (commands->height / 2 - fontSize / 2) + 75,
+                 fontSize2, RED);
+    }
+}
@@ -0,0 +1,218 @@
+#if !defined(ASTEROIDS_RENDER_H)
+#define ASTEROIDS_RENDER_H
+
+// NOTE(trist007): The game describes a frame as a list of render commands
+// instead of drawing it. GameRender pushes them into an arena, the platform
+// layer adds its own overlay on top and hands the list to whatever backend
+// it has: raylib on win32, just counting in the headless runner. The list
+// is plain data, so it can be counted, sorted, merged or saved without the
+// game knowing about any of it.
+//
+// Commands are packed back to back in push order, each a
+// RenderCommandHeader followed by its Render struct. Walk them with
+// firstRenderCommand and nextRenderCommand.
+//
+// GameRender doesn't read the GameState but a RenderState, a copy of just
+// what gets drawn taken after a tick. A renderer on another thread reads
+// them out of a RenderStateBuffer while the sim goes on ticking.
+
+#define RENDER_CLEAR 0
+#define RENDER_CIRCLE 1
+#define RENDER_TRIANGLE 2
+#define RENDER_LINE 3
+#define RENDER_TEXT 4
+#define RENDER_CIRCLE_INSTANCES 5
+#define RENDER_COMMAND_TYPE_COUNT 6
+
+// Longest text a single command holds, the rest gets cut off
+#define RENDER_MAX_TEXT 255
+
+// Most instances one RENDER_CIRCLE_INSTANCES command holds, the next one
+// starts another command. Keeps the command under the 64 KB header size.
+#define RENDER_MAX_INSTANCES 2048
+
+// Edges of the unit circle mesh instances are drawn from
+#define RENDER_CIRCLE_SEGMENTS 24
+
+// What an immediate mode backend sends for a circle, raylib's DrawCircleV
+// builds a fan of 36 triangles every call
+#define RENDER_FAN_CIRCLE_VERTICES (36 * 3)
+
+// raylib's palette for the headless build, same values
+#if !defined(RAYWHITE)
+#define RAYWHITE Color{ 245, 245, 245, 255 }
+#define RED Color{ 230, 41, 55, 255 }
+#define GRAY Color{ 130, 130, 130, 255 }
+#define BLACK Color{ 0, 0, 0, 255 }
+#define LIME Color{ 0, 158, 47, 255 }
+#endif
+
+typedef struct
+{
+    unsigned short type;
+    
+    // Bytes to the next command, header included
+    unsigned short size;
+} RenderCommandHeader;
+
+typedef struct
+{
+    Color color;
+} RenderClear;
+
+typedef struct
+{
+    Vector2 center;
+    float radius;
+    Color color;
+} RenderCircle;
+
+// Filled, counter clockwise on screen like raylib wants them
+typedef struct
+{
+    Vector2 v1;
+    Vector2 v2;
+    Vector2 v3;
+    Color color;
+} RenderTriangle;
+
+// One pixel wide
+typedef struct
+{
+    Vector2 from;
+    Vector2 to;
+    Color color;
+} RenderLine;
+
+// length chars follow the struct, no terminator
+typedef struct
+{
+    int x;
+    int y;
+    int fontSize;
+    Color color;
+    int length;
+} RenderText;
+
+typedef struct
+{
+    Vector2 center;
+    float radius;
+    float rotation;
+    Color color;
+} RenderInstance;
+
+// NOTE(trist007): count RenderInstances follow the struct. Each one is the
+// unit circle mesh turned by rotation, scaled by radius and moved to
+// center, so the backend can send the whole lot as one batch instead of a
+// draw call per circle.
+typedef struct
+{
+    int count;
+} RenderCircleInstances;
+
+// Unit circle, counter clockwise on screen, built once by the backend
+typedef struct
+{
+    Vector2 vertex[RENDER_CIRCLE_SEGMENTS];
+} RenderCircleMesh;
+
+// What a backend sent for a frame
+typedef struct
+{
+    int drawCalls;
+    long long vertices;
+} RenderDrawStats;
+
+typedef struct
+{
+    Arena *arena;
+    unsigned char *base;
+    size_t used;
+    
+    // Last command when it's an instance batch with room left, instances
+    // get appended to it
+    RenderCommandHeader *openInstances;
+    
+    int width;
+    int height;
+    
+    // Stats
+    int count;
+    int typeCount[RENDER_COMMAND_TYPE_COUNT];
+    int instanceCount;
+    int dropped;
+} RenderCommands;
+
+void beginRenderCommands(RenderCommands *commands, Arena *arena, int width, int height);
+void pushClear(RenderCommands *commands, Color color);
+void pushCircle(RenderCommands *commands, Vector2 center, float radius, Color color);
+void pushTriangle(RenderCommands *commands, Vector2 v1, Vector2 v2, Vector2 v3, Color color);
+void pushLine(RenderCommands *commands, Vector2 from, Vector2 to, Color color);
+void pushText(RenderCommands *commands, const char *text, int x, int y, int fontSize, Color color);
+void pushCircleInstance(RenderCommands *commands, Vector2 center, float radius, float rotation, Color color);
+RenderCommandHeader *firstRenderCommand(RenderCommands *commands);
+RenderCommandHeader *nextRenderCommand(RenderCommands *commands, RenderCommandHeader *header);
+const char *renderTextChars(RenderText *text);
+RenderInstance *renderInstances(RenderCircleInstances *instances);
+void buildCircleMesh(RenderCircleMesh *mesh);
+void countRenderDraw(RenderDrawStats *stats, RenderCommandHeader *header);
+
+// NOTE(trist007): immutable once published. Sized for the pools of the
+// config it was pushed with.
+typedef struct
+{
+    GameConfig config;
+    Ship ship;
+    bool gameOver;
+    
+    int bulletCount;
+    Vector2 *bulletPos;
+    Vector2 *bulletPrevPos;
+    
+    int asteroidCount;
+    float *x;
+    float *y;
+    float *prevX;
+    float *prevY;
+    float *radius;
+    
+    // Filled in by whoever owns them, for the overlay and the stats
+    int replayState;
+    long long replayLoops;
+    long long tick;
+    double publishedSeconds;
+    long long inputSequence;
+} RenderState;
+
+// Flag on RenderStateBuffer.middle, set while it holds a state the reader
+// hasn't picked up
+#define RENDER_STATE_FRESH 4
+
+// NOTE(trist007): triple buffer, one writer and one reader, no locks. The
+// writer fills its back slot and swaps it with the middle one, the reader
+// swaps its front slot with the middle one when there's something fresh in
+// it. Neither ever waits and the reader always gets the newest state, the
+// ones it was too slow for just get written over.
+typedef struct
+{
+    RenderState slots[3];
+    int back;
+    volatile long middle;
+    int front;
+} RenderStateBuffer;
+
+bool pushRenderState(Arena *arena, RenderState *state, GameConfig *config);
+void captureRenderState(GameState *gs, RenderState *state);
+bool pushRenderStateBuffer(Arena *arena, RenderStateBuffer *buffer, GameConfig *config);
+RenderState *beginRenderStateWrite(RenderStateBuffer *buffer);
+void publishRenderState(RenderStateBuffer *buffer);
+RenderState *acquireRenderState(RenderStateBuffer *buffer, bool *fresh);
+
+void GameRender(RenderState *state, RenderCommands *commands, float alpha);
+
+// Provided by the platform layer: width in pixels of text drawn at fontSize
+// by its backend, so the game can lay text out
+int platformMeasureText(const char *text, int fontSize);
+
+#endif
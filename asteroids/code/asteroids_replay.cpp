@@ -0,0 +1,96 @@
+#include "asteroids_replay.h"
+
+#include <string.h>
+
+void
+initializeReplay(InputReplay *replay, Arena *arena, Arena *storage)
+{
+    *replay = {};
+    replay->arena = arena;
+    replay->storage = storage;
+}
+
+// Throws away whatever was recorded before
+bool
+beginRecording(InputReplay *replay)
+{
+    Arena *arena = replay->arena;
+    arena_reset(replay->storage);
+    
+    replay->state = REPLAY_IDLE;
+    replay->startState = (unsigned char *)arena_alloc_aligned(replay->storage, arena->used, 64);
+    if(!replay->startState) return(false);
+    
+    memcpy(replay->startState, arena->base, arena->used);
+    replay->startUsed = arena->used;
+    
+    // The log grows right after the copy, one GameInput at a time
+    replay->inputs = (GameInput *)(replay->storage->base + replay->storage->used);
+    replay->inputCount = 0;
+    replay->playIndex = 0;
+    replay->loops = 0;
+    replay->state = REPLAY_RECORDING;
+    return(true);
+}
+
+// Call once per tick with the input that tick runs on
+bool
+recordInput(InputReplay *replay, GameInput *input)
+{
+    bool result = false;
+    if(replay->state == REPLAY_RECORDING)
+    {
+        GameInput *slot = arena_push(replay->storage, GameInput);
+        if(slot)
+        {
+            *slot = *input;
+            replay->inputCount++;
+            result = true;
+        }
+    }
+    return(result);
+}
+
+static void
+replayRestoreStart(InputReplay *replay)
+{
+    memcpy(replay->arena->base, replay->startState, replay->startUsed);
+    replay->arena->used = replay->startUsed;
+    replay->playIndex = 0;
+}
+
+bool
+beginPlayback(InputReplay *replay)
+{
+    replay->state = REPLAY_IDLE;
+    if(replay->startState && replay->inputCount > 0)
+    {
+        replayRestoreStart(replay);
+        replay->state = REPLAY_PLAYING;
+    }
+    return(replay->state == REPLAY_PLAYING);
+}
+
+// Call once per tick in place of reading the controls. At the end of the log
+// the arena goes back to the start state first, so the tick that follows is
+// the first recorded one again.
+void
+playbackInput(InputReplay *replay, GameInput *input)
+{
+    if(replay->state == REPLAY_PLAYING)
+    {
+        if(replay->playIndex == replay->inputCount)
+        {
+            replayRestoreStart(replay);
+            replay->loops++;
+        }
+        *input = replay->inputs[replay->playIndex++];
+    }
+}
+
+// Leaves the arena wherever playback got to, the recording is kept
+void
+endReplay(InputReplay *replay)
+{
+    replay->state = REPLAY_IDLE;
+}
@@ -0,0 +1,40 @@
+#if !defined(ASTEROIDS_REPLAY_H)
+#define ASTEROIDS_REPLAY_H
+
+// NOTE(trist007): Handmade style input recording. Starting a recording copies
+// the game arena and then logs the GameInput of every tick. Playback puts the
+// copy back and feeds the logged inputs instead of the live ones, looping
+// back to the copy when it runs out. The sim is deterministic given its
+// arena (the generator lives in GameState), so every loop replays the same
+// ticks. That makes a repeatable workload for profiling and a regression
+// check for sim changes.
+
+#define REPLAY_IDLE 0
+#define REPLAY_RECORDING 1
+#define REPLAY_PLAYING 2
+
+typedef struct
+{
+    int state;
+    
+    // The game arena being recorded, and where the copy and log go
+    Arena *arena;
+    Arena *storage;
+    
+    unsigned char *startState;
+    size_t startUsed;
+    GameInput *inputs;
+    int inputCount;
+    
+    int playIndex;
+    long long loops;
+} InputReplay;
+
+void initializeReplay(InputReplay *replay, Arena *arena, Arena *storage);
+bool beginRecording(InputReplay *replay);
+bool recordInput(InputReplay *replay, GameInput *input);
+bool beginPlayback(InputReplay *replay);
+void playbackInput(InputReplay *replay, GameInput *input);
+void endReplay(InputReplay *replay);
+
+#endif
@@ -0,0 +1,363 @@
+#include "asteroids_snapshot.h"
+
+#include <string.h>
+
+static SnapshotPage *
+snapshotAllocPage(SnapshotRing *ring)
+{
+    SnapshotPage *page = ring->freePages;
+    if(page)
+    {
+        ring->freePages = page->nextFree;
+    }
+    else
+    {
+        page = arena_push(ring->storage, SnapshotPage);
+        unsigned char *data = page ? (unsigned char *)arena_alloc_aligned(ring->storage, SNAPSHOT_PAGE_SIZE, 64) : 0;
+        if(!data) return(0);
+        page->data = data;
+        ring->pagesAllocated++;
+    }
+    page->refCount = 0;
+    page->nextFree = 0;
+    return(page);
+}
+
+static void
+snapshotReleasePage(SnapshotRing *ring, SnapshotPage *page)
+{
+    Assert(page->refCount > 0);
+    if(--page->refCount == 0)
+    {
+        page->nextFree = ring->freePages;
+        ring->freePages = page;
+    }
+}
+
+static void
+snapshotReleaseSlot(SnapshotRing *ring, Snapshot *slot)
+{
+    if(slot->valid)
+    {
+        if(ring->mode == SNAPSHOT_DIRTY_PAGES)
+        {
+            for(size_t p = 0;
+                p < slot->pageCount;
+                p++)
+            {
+                snapshotReleasePage(ring, slot->pages[p]);
+            }
+        }
+        slot->valid = false;
+        ring->count--;
+    }
+}
+
+// Watch whatever the arena committed since the last call. If the platform
+// ever stops watching we can't trust it any more and every page counts as
+// written from then on.
+static size_t
+snapshotCollectWrites(SnapshotRing *ring, bool markDirty)
+{
+    Arena *arena = ring->arena;
+    if(arena->committed > ring->watched)
+    {
+        if(!platformWatchWrites(arena->base + ring->watched, arena->committed - ring->watched))
+        {
+            ring->watched = (size_t)-1;
+        }
+        else
+        {
+            ring->watched = arena->committed;
+        }
+    }
+    
+    size_t count = 0;
+    if(ring->watched == (size_t)-1)
+    {
+        for(size_t p = 0;
+            p < ring->maxPages;
+            p++)
+        {
+            ring->written[count++] = p;
+        }
+    }
+    else
+    {
+        size_t watchedPages = ring->watched / SNAPSHOT_PAGE_SIZE;
+        if(watchedPages > ring->maxPages) watchedPages = ring->maxPages;
+        count = platformGetWrittenPages(arena->base, watchedPages * SNAPSHOT_PAGE_SIZE, ring->written, ring->maxPages);
+    }
+    
+    if(markDirty)
+    {
+        for(size_t i = 0;
+            i < count;
+            i++)
+        {
+            ring->dirty[ring->written[i]] = 1;
+        }
+    }
+    return(count);
+}
+
+static void
+snapshotClearDirty(SnapshotRing *ring, size_t writtenCount)
+{
+    for(size_t i = 0;
+        i < writtenCount;
+        i++)
+    {
+        ring->dirty[ring->written[i]] = 0;
+    }
+}
+
+// True when the arena page may no longer match the baseline
+static bool
+snapshotPageChanged(SnapshotRing *ring, size_t page)
+{
+    return(ring->dirty[page] || page >= ring->baselineCount || !ring->baseline[page]);
+}
+
+static size_t
+snapshotPageBytes(Arena *arena, size_t page)
+{
+    size_t offset = page * SNAPSHOT_PAGE_SIZE;
+    size_t bytes = arena->committed - offset;
+    return(bytes < SNAPSHOT_PAGE_SIZE ? bytes : SNAPSHOT_PAGE_SIZE);
+}
+
+// storage holds the ring and the copies and must not be the arena being
+// snapshotted. maxBytes caps how much of the arena a snapshot can hold.
+SnapshotRing *
+initializeSnapshotRing(Arena *storage, Arena *arena, int slotCount, size_t maxBytes, int mode)
+{
+    SnapshotRing *ring = arena_push(storage, SnapshotRing);
+    if(!ring) return(0);
+    
+    *ring = {};
+    ring->arena = arena;
+    ring->storage = storage;
+    ring->maxBytes = maxBytes;
+    ring->maxPages = (maxBytes + SNAPSHOT_PAGE_SIZE - 1) / SNAPSHOT_PAGE_SIZE;
+    ring->slotCount = slotCount;
+    ring->slots = arena_push_array(storage, Snapshot, slotCount);
+    if(!ring->slots) return(0);
+    memset(ring->slots, 0, slotCount * sizeof(Snapshot));
+    
+    // NOTE(trist007): write watching works on whole pages, a sub arena that
+    // doesn't start on one can only do full copies
+    ring->mode = mode;
+    if(mode == SNAPSHOT_DIRTY_PAGES &&
+       (((size_t)arena->base % SNAPSHOT_PAGE_SIZE) != 0 || !platformWatchWrites(arena->base, arena->committed)))
+    {
+        ring->mode = SNAPSHOT_FULL_COPY;
+    }
+    
+    if(ring->mode == SNAPSHOT_DIRTY_PAGES)
+    {
+        ring->watched = arena->committed;
+        ring->baseline = arena_push_array(storage, SnapshotPage *, ring->maxPages);
+        ring->written = arena_push_array(storage, size_t, ring->maxPages);
+        ring->dirty = arena_push_array(storage, unsigned char, ring->maxPages);
+        if(!ring->baseline || !ring->written || !ring->dirty) return(0);
+        memset(ring->dirty, 0, ring->maxPages);
+        
+        for(int i = 0;
+            i < slotCount;
+            i++)
+        {
+            ring->slots[i].pages = arena_push_array(storage, SnapshotPage *, ring->maxPages);
+            if(!ring->slots[i].pages) return(0);
+        }
+    }
+    else
+    {
+        for(int i = 0;
+            i < slotCount;
+            i++)
+        {
+            ring->slots[i].data = arena_push_array(storage, unsigned char, maxBytes);
+            if(!ring->slots[i].data) return(0);
+        }
+    }
+    
+    return(ring);
+}
+
+void
+releaseSnapshotRing(SnapshotRing *ring)
+{
+    if(ring->mode == SNAPSHOT_DIRTY_PAGES && ring->watched != (size_t)-1)
+    {
+        platformUnwatchWrites(ring->arena->base, ring->watched);
+    }
+}
+
+// age 0 is the newest snapshot
+Snapshot *
+getSnapshot(SnapshotRing *ring, int age)
+{
+    Snapshot *result = 0;
+    if(age >= 0 && age < ring->count)
+    {
+        result = ring->slots + (ring->head - 1 - age + ring->slotCount) % ring->slotCount;
+    }
+    return(result);
+}
+
+// NOTE(trist007): a full ring drops its oldest snapshot to make room, and
+// so does a save that fails for lack of storage
+bool
+saveSnapshot(SnapshotRing *ring, long long tag)
+{
+    Arena *arena = ring->arena;
+    if(arena->used > ring->maxBytes) return(false);
+    
+    Snapshot *slot = ring->slots + ring->head;
+    snapshotReleaseSlot(ring, slot);
+    
+    if(ring->mode == SNAPSHOT_DIRTY_PAGES)
+    {
+        size_t pageCount = (arena->used + SNAPSHOT_PAGE_SIZE - 1) / SNAPSHOT_PAGE_SIZE;
+        size_t writtenCount = snapshotCollectWrites(ring, true);
+        
+        // Grab every page the save needs up front so running out of storage
+        // can't leave the baseline half updated
+        SnapshotPage *fresh = 0;
+        for(size_t p = 0;
+            p < pageCount;
+            p++)
+        {
+            if(snapshotPageChanged(ring, p))
+            {
+                SnapshotPage *page = snapshotAllocPage(ring);
+                if(!page)
+                {
+                    while(fresh)
+                    {
+                        SnapshotPage *next = fresh->nextFree;
+                        fresh->nextFree = ring->freePages;
+                        ring->freePages = fresh;
+                        fresh = next;
+                    }
+                    
+                    // The watch has already forgotten these writes, drop them
+                    // from the baseline so the next save copies them anyway
+                    for(size_t i = 0;
+                        i < writtenCount;
+                        i++)
+                    {
+                        size_t written = ring->written[i];
+                        if(written < ring->baselineCount && ring->baseline[written])
+                        {
+                            snapshotReleasePage(ring, ring->baseline[written]);
+                            ring->baseline[written] = 0;
+                        }
+                    }
+                    snapshotClearDirty(ring, writtenCount);
+                    return(false);
+                }
+                page->nextFree = fresh;
+                fresh = page;
+            }
+        }
+        
+        for(size_t p = 0;
+            p < pageCount;
+            p++)
+        {
+            if(snapshotPageChanged(ring, p))
+            {
+                SnapshotPage *page = fresh;
+                fresh = page->nextFree;
+                page->nextFree = 0;
+                page->refCount = 1;
+                memcpy(page->data, arena->base + p * SNAPSHOT_PAGE_SIZE, snapshotPageBytes(arena, p));
+                ring->bytesCopied += SNAPSHOT_PAGE_SIZE;
+                
+                if(p < ring->baselineCount && ring->baseline[p]) snapshotReleasePage(ring, ring->baseline[p]);
+                ring->baseline[p] = page;
+            }
+            
+            slot->pages[p] = ring->baseline[p];
+            slot->pages[p]->refCount++;
+        }
+        
+        for(size_t p = pageCount;
+            p < ring->baselineCount;
+            p++)
+        {
+            if(ring->baseline[p]) snapshotReleasePage(ring, ring->baseline[p]);
+        }
+        ring->baselineCount = pageCount;
+        slot->pageCount = pageCount;
+        snapshotClearDirty(ring, writtenCount);
+    }
+    else
+    {
+        memcpy(slot->data, arena->base, arena->used);
+        ring->bytesCopied += arena->used;
+    }
+    
+    slot->valid = true;
+    slot->tag = tag;
+    slot->used = arena->used;
+    ring->head = (ring->head + 1) % ring->slotCount;
+    ring->count++;
+    ring->saves++;
+    return(true);
+}
+
+// Puts the arena back the way it was age saves ago. Every snapshot is kept,
+// newer ones included, so a search can hop between branches.
+bool
+restoreSnapshot(SnapshotRing *ring, int age)
+{
+    Snapshot *snapshot = getSnapshot(ring, age);
+    if(!snapshot) return(false);
+    
+    Arena *arena = ring->arena;
+    if(ring->mode == SNAPSHOT_DIRTY_PAGES)
+    {
+        size_t writtenCount = snapshotCollectWrites(ring, true);
+        
+        for(size_t p = 0;
+            p < snapshot->pageCount;
+            p++)
+        {
+            SnapshotPage *page = snapshot->pages[p];
+            if(snapshotPageChanged(ring, p) || ring->baseline[p] != page)
+            {
+                memcpy(arena->base + p * SNAPSHOT_PAGE_SIZE, page->data, snapshotPageBytes(arena, p));
+                ring->bytesCopied += SNAPSHOT_PAGE_SIZE;
+                
+                page->refCount++;
+                if(p < ring->baselineCount && ring->baseline[p]) snapshotReleasePage(ring, ring->baseline[p]);
+                ring->baseline[p] = page;
+            }
+        }
+        
+        for(size_t p = snapshot->pageCount;
+            p < ring->baselineCount;
+            p++)
+        {
+            if(ring->baseline[p]) snapshotReleasePage(ring, ring->baseline[p]);
+        }
+        ring->baselineCount = snapshot->pageCount;
+        snapshotClearDirty(ring, writtenCount);
+        
+        // Our own copies just tripped the watch, those pages match the
+        // baseline so forget them
+        snapshotCollectWrites(ring, false);
+    }
+    else
+    {
+        memcpy(arena->base, snapshot->data, snapshot->used);
+        ring->bytesCopied += snapshot->used;
+    }
+    
+    arena->used = snapshot->used;
+    ring->restores++;
+    return(true);
+}
@@ -0,0 +1,97 @@
+#if !defined(ASTEROIDS_SNAPSHOT_H)
+#define ASTEROIDS_SNAPSHOT_H
+
+// NOTE(trist007): Save states for rollback and bot tree search. Everything a
+// game needs lives in its permanent arena as plain data, so a snapshot is
+// just the arena's bytes and restoring is copying them back over the same
+// base. Pointers into the arena stay valid, pointers out of it (the transient
+// arena) aren't touched.
+//
+// Snapshots sit in a ring of slotCount, saving into a full ring drops the
+// oldest. Two ways of storing them:
+//
+// SNAPSHOT_FULL_COPY copies arena.used bytes per save. Fine for a single
+// GameState, a couple of KB.
+//
+// SNAPSHOT_DIRTY_PAGES is for big arenas (thousands of games) where a tick
+// only touches a few pages. The platform write-watches the arena and a save
+// copies just the pages written since the last save or restore, every other
+// page is shared with the previous snapshot through a refcounted page table.
+// Restore only rewrites the pages that differ from the target. Falls back to
+// full copies if the platform can't watch writes.
+//
+// Saves and restores must happen between ticks, nothing may be writing the
+// arena while they run.
+
+#define SNAPSHOT_FULL_COPY 0
+#define SNAPSHOT_DIRTY_PAGES 1
+
+// Dirty tracking granularity, the platform write-watches at this size
+#define SNAPSHOT_PAGE_SIZE 4096
+
+typedef struct SnapshotPage
+{
+    unsigned char *data;
+    int refCount;
+    struct SnapshotPage *nextFree;
+} SnapshotPage;
+
+typedef struct
+{
+    bool valid;
+    long long tag;
+    size_t used;
+    
+    // SNAPSHOT_FULL_COPY
+    unsigned char *data;
+    
+    // SNAPSHOT_DIRTY_PAGES, one entry per page of [0, used)
+    SnapshotPage **pages;
+    size_t pageCount;
+} Snapshot;
+
+typedef struct
+{
+    Arena *arena;
+    Arena *storage;
+    int mode;
+    size_t maxBytes;
+    size_t maxPages;
+    
+    int slotCount;
+    int head; // next slot to write
+    int count;
+    Snapshot *slots;
+    
+    // What the arena held at the last save or restore, clean pages are
+    // taken from here instead of copied
+    SnapshotPage **baseline;
+    size_t baselineCount;
+    
+    SnapshotPage *freePages;
+    size_t *written;
+    unsigned char *dirty;
+    size_t watched;
+    
+    // Stats
+    long long saves;
+    long long restores;
+    unsigned long long bytesCopied;
+    size_t pagesAllocated;
+} SnapshotRing;
+
+SnapshotRing *initializeSnapshotRing(Arena *storage, Arena *arena, int slotCount, size_t maxBytes, int mode);
+void releaseSnapshotRing(SnapshotRing *ring);
+bool saveSnapshot(SnapshotRing *ring, long long tag);
+bool restoreSnapshot(SnapshotRing *ring, int age);
+Snapshot *getSnapshot(SnapshotRing *ring, int age);
+
+// Provided by the platform layer: page write tracking. Watch returns false
+// when it isn't supported. GetWrittenPages fills in the page indices (from
+// base, in SNAPSHOT_PAGE_SIZE pages) written since the previous call and
+// starts tracking them again.
+bool platformWatchWrites(void *base, size_t size);
+size_t platformGetWrittenPages(void *base, size_t size, size_t *pages, size_t maxPages);
+void platformUnwatchWrites(void *base, size_t size);
+
+#endif
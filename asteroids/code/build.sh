@@ -0,0 +1,18 @@
+#!/bin/bash
+
+# Headless linux build, no raylib required
+
+# -fno-associative-math: fast math may otherwise regroup the swept collision
+# test differently wherever it gets inlined, and the broadphases have to agree
+# with the SIMD kernels bit for bit on grazing hits
+CommonCompilerFlags="-std=c++11 -O3 -g -ffast-math -fno-associative-math -fno-exceptions -fno-rtti -Wall -Wno-unused-variable -Wno-unused-function -Wno-missing-braces"
+CommonLinkerFlags="-lm -pthread"
+
+code="$(cd "$(dirname "$0")" && pwd)"
+
+mkdir -p "$code/../../build"
+pushd "$code/../../build" > /dev/null
+
+g++ $CommonCompilerFlags "$code/linux_asteroids.cpp" -o linux_asteroids $CommonLinkerFlags
+
+popd > /dev/null
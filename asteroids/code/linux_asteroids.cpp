@@ -0,0 +1,2795 @@
+// Headless linux platform layer. Drives GameUpdate with scripted input as
+// fast as the CPU allows, no window, GPU or raylib.
+//
+//   linux_asteroids [ticks]          one game, prints simulated ticks per second
+//   linux_asteroids batch [ticks]    N games stepped together, prints game-ticks per second
+//   linux_asteroids sessions [sessions] [ticks] [workers]
+//                                    work-stealing scaling benchmark over 1..workers threads
+//                                    and a steal only run, checked against one worker
+//   linux_asteroids arena [games] [ticks]
+//                                    batch world on 4 KB, transparent huge and explicit huge pages
+//   linux_asteroids snapshot [games] [saves] [touched]
+//                                    save state throughput
+//   linux_asteroids random [lanes] [rounds]
+//                                    replay and batch bit-exactness, lane fill throughput
+//   linux_asteroids replay [ticks] [loops]
+//                                    loops a recorded input stream
+//   linux_asteroids soa [asteroids] [ticks]
+//                                    asteroid layouts compared
+//   linux_asteroids handles [entities] [rounds]
+//                                    generational handles under churn
+//   linux_asteroids mask [slots] [ticks]
+//                                    bool vs bitmask iteration over the bullet pool
+//   linux_asteroids narrowphase [asteroids] [rounds]
+//                                    SIMD circle test vs scalar, per pair, alone and listing hits
+//   linux_asteroids swarm [asteroids] [bullets] [ticks] [grid|sweep|brute]
+//                                    per-phase frame budget under huge pools
+//   linux_asteroids broadphase [bullets] [ticks] [swept] [wrap] [speed multiplier]
+//                                    brute force, grid and sweep and prune from 1k to 100k asteroids
+//   linux_asteroids tunnel [shots] [max speed multiplier]
+//                                    bullets tunnelling at 120 down to 20 Hz, discrete and swept
+//   linux_asteroids resolve          one bullet over two asteroids takes only the nearest
+//   linux_asteroids render [asteroids] [frames]
+//                                    render commands, draw calls and vertices per frame
+//   linux_asteroids raster [asteroids] [frames] [workers] [golden.ppm]
+//                                    tile parallel software rasteriser, checked against a golden
+//   linux_asteroids present [asteroids] [seconds]
+//                                    frame time and input latency, sim in the loop vs threaded
+//   linux_asteroids wrap [asteroids] [bullets] [ticks]
+//                                    collisions across the seams, wrapping vs despawning
+//
+// README.md has the longer version.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "asteroids.cpp"
+#include "asteroids_batch.cpp"
+#include "asteroids_snapshot.cpp"
+#include "asteroids_replay.cpp"
+#include "asteroids_render.cpp"
+#include "asteroids_raster.cpp"
+
+// Same as the software rasteriser's font, which is close to what raylib's
+// default one measures
+int
+platformMeasureText(const char *text, int fontSize)
+{
+    int scale = fontSize / 10;
+    if(scale < 1) scale = 1;
+    return((int)strlen(text) * (RASTER_GLYPH_WIDTH + 1) * scale);
+}
+
+static double
+linuxGetSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return(ts.tv_sec + ts.tv_nsec / 1000000000.0);
+}
+
+// Timed loops store what they computed here, so the compiler can't drop them
+static volatile long long linuxBenchmarkSink;
+
+// Scripted pilot: keep turning and fire every few ticks so bullets,
+// splits and collisions all get exercised. Games in a batch get offset
+// scripts so they don't all play in lockstep.
+static GameInput
+linuxBotInput(long long frame, int game = 0)
+{
+    frame += game * 37;
+    
+    GameInput input = {};
+    input.rotateRight = true;
+    input.thrust = (frame % (2*SIM_HZ)) < (SIM_HZ / 3);
+    input.fire = (frame % (SIM_HZ / 8)) == 0;
+    return(input);
+}
+
+// NOTE(trist007): reservations are PROT_NONE and MAP_NORESERVE so they cost
+// nothing but address space, commit swaps a range for real pages. The base
+// is 2 MB aligned so huge pages can back it.
+void *
+platformReserveMemory(size_t size, int pageFlags)
+{
+    size = (size + 4095) & ~(size_t)4095;
+    size_t padded = size + ARENA_HUGE_PAGE_SIZE;
+    void *memory = mmap(0, padded, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(memory == MAP_FAILED) return(0);
+    
+    // Trim the slop on both sides of the aligned range
+    size_t address = (size_t)memory;
+    size_t aligned = (address + ARENA_HUGE_PAGE_SIZE - 1) & ~(ARENA_HUGE_PAGE_SIZE - 1);
+    if(aligned > address) munmap(memory, aligned - address);
+    size_t tail = (address + padded) - (aligned + size);
+    if(tail) munmap((void *)(aligned + size), tail);
+    
+    return((void *)aligned);
+}
+
+size_t
+platformCommitMemory(void *base, size_t size, int pageFlags)
+{
+    size_t pageSize = 0;
+    
+    if((pageFlags & ARENA_PAGES_EXPLICIT_HUGE) && (size % ARENA_HUGE_PAGE_SIZE) == 0)
+    {
+        // Fails cleanly with ENOMEM when the hugetlb pool is empty or unset
+        void *memory = mmap(base, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0);
+        if(memory != MAP_FAILED) pageSize = ARENA_HUGE_PAGE_SIZE;
+    }
+    
+    if(!pageSize)
+    {
+        // MAP_FIXED rather than mprotect, a failed hugetlb map can leave a hole
+        void *memory = mmap(base, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+        if(memory != MAP_FAILED)
+        {
+            pageSize = 4096;
+            
+            // Counted as huge if the kernel accepted the hint, THP decides
+            // for itself when to actually collapse the pages
+            if(pageFlags && madvise(base, size, MADV_HUGEPAGE) == 0)
+            {
+                pageSize = ARENA_HUGE_PAGE_SIZE;
+            }
+        }
+    }
+    
+    return(pageSize);
+}
+
+void
+platformReleaseMemory(void *base, size_t size)
+{
+    munmap(base, size);
+}
+
+// NOTE(trist007): write watching for snapshot dirty pages. A watched range is
+// write protected, the first write to a page faults into the handler which
+// marks the page and makes it writable again. Collecting the written pages
+// protects them again. Ranges that extend the previous one (an arena
+// committing more) are merged so a watch is one bitmap per arena.
+#define LINUX_MAX_WATCHES 16
+
+typedef struct
+{
+    unsigned char *base;
+    size_t size;
+    unsigned long long *bits;
+    size_t bitsSize;
+} LinuxWriteWatch;
+
+static LinuxWriteWatch linuxWatches[LINUX_MAX_WATCHES];
+
+static void
+linuxWriteFaultHandler(int signal, siginfo_t *info, void *context)
+{
+    unsigned char *address = (unsigned char *)info->si_addr;
+    for(int i = 0;
+        i < LINUX_MAX_WATCHES;
+        i++)
+    {
+        LinuxWriteWatch *watch = linuxWatches + i;
+        if(watch->base && address >= watch->base && address < watch->base + watch->size)
+        {
+            size_t page = (address - watch->base) / SNAPSHOT_PAGE_SIZE;
+            __atomic_fetch_or(watch->bits + page / 64, 1ULL << (page % 64), __ATOMIC_RELAXED);
+            mprotect(watch->base + page * SNAPSHOT_PAGE_SIZE, SNAPSHOT_PAGE_SIZE, PROT_READ | PROT_WRITE);
+            return;
+        }
+    }
+    
+    // Not ours (an Assert, a real bug), fault again with the default action
+    struct sigaction action = {};
+    action.sa_handler = SIG_DFL;
+    sigaction(SIGSEGV, &action, 0);
+}
+
+static unsigned long long *
+linuxAllocWatchBits(size_t size, size_t *bitsSize)
+{
+    size_t pages = (size + SNAPSHOT_PAGE_SIZE - 1) / SNAPSHOT_PAGE_SIZE;
+    *bitsSize = (((pages + 63) / 64) * sizeof(unsigned long long) + 4095) & ~(size_t)4095;
+    void *bits = mmap(0, *bitsSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return(bits == MAP_FAILED ? 0 : (unsigned long long *)bits);
+}
+
+bool
+platformWatchWrites(void *base, size_t size)
+{
+    static bool handlerInstalled;
+    if(!handlerInstalled)
+    {
+        struct sigaction action = {};
+        action.sa_sigaction = linuxWriteFaultHandler;
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        if(sigaction(SIGSEGV, &action, 0) != 0) return(false);
+        handlerInstalled = true;
+    }
+    if(!size) return(true);
+    
+    LinuxWriteWatch *watch = 0;
+    for(int i = 0;
+        i < LINUX_MAX_WATCHES;
+        i++)
+    {
+        if(linuxWatches[i].base && linuxWatches[i].base + linuxWatches[i].size == (unsigned char *)base)
+        {
+            watch = linuxWatches + i;
+            break;
+        }
+    }
+    
+    if(watch)
+    {
+        // Grow the bitmap, nothing is writing the watched range while we do
+        size_t bitsSize;
+        unsigned long long *bits = linuxAllocWatchBits(watch->size + size, &bitsSize);
+        if(!bits) return(false);
+        memcpy(bits, watch->bits, watch->bitsSize);
+        munmap(watch->bits, watch->bitsSize);
+        watch->bits = bits;
+        watch->bitsSize = bitsSize;
+        watch->size += size;
+    }
+    else
+    {
+        for(int i = 0;
+            i < LINUX_MAX_WATCHES;
+            i++)
+        {
+            if(!linuxWatches[i].base)
+            {
+                watch = linuxWatches + i;
+                break;
+            }
+        }
+        if(!watch) return(false);
+        
+        watch->bits = linuxAllocWatchBits(size, &watch->bitsSize);
+        if(!watch->bits) return(false);
+        watch->size = size;
+        watch->base = (unsigned char *)base;
+    }
+    
+    return(mprotect(base, size, PROT_READ) == 0);
+}
+
+size_t
+platformGetWrittenPages(void *base, size_t size, size_t *pages, size_t maxPages)
+{
+    size_t count = 0;
+    for(int i = 0;
+        i < LINUX_MAX_WATCHES;
+        i++)
+    {
+        LinuxWriteWatch *watch = linuxWatches + i;
+        if(watch->base != (unsigned char *)base) continue;
+        
+        size_t pageCount = (size < watch->size ? size : watch->size) / SNAPSHOT_PAGE_SIZE;
+        for(size_t word = 0;
+            word < (pageCount + 63) / 64;
+            word++)
+        {
+            if(!watch->bits[word]) continue;
+            unsigned long long bits = __atomic_exchange_n(watch->bits + word, 0, __ATOMIC_RELAXED);
+            while(bits)
+            {
+                size_t page = word * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                if(page >= pageCount || count == maxPages)
+                {
+                    // Out of the asked range, leave it marked
+                    __atomic_fetch_or(watch->bits + word, 1ULL << (page % 64), __ATOMIC_RELAXED);
+                    continue;
+                }
+                
+                // Runs of pages go back under protection with one call
+                size_t run = 1;
+                while(count + run < maxPages && (bits & 1ULL << ((page + run) % 64)) && (page + run) / 64 == word)
+                {
+                    pages[count + run] = page + run;
+                    bits &= bits - 1;
+                    run++;
+                }
+                pages[count] = page;
+                mprotect(watch->base + page * SNAPSHOT_PAGE_SIZE, run * SNAPSHOT_PAGE_SIZE, PROT_READ);
+                count += run;
+            }
+        }
+    }
+    return(count);
+}
+
+void
+platformUnwatchWrites(void *base, size_t size)
+{
+    for(int i = 0;
+        i < LINUX_MAX_WATCHES;
+        i++)
+    {
+        LinuxWriteWatch *watch = linuxWatches + i;
+        if(watch->base == (unsigned char *)base)
+        {
+            mprotect(watch->base, watch->size, PROT_READ | PROT_WRITE);
+            munmap(watch->bits, watch->bitsSize);
+            *watch = {};
+        }
+    }
+}
+
+// Pool stats reset with every game, the runner sums them over a whole run
+static void
+linuxAddPoolStats(PoolStats *total, PoolStats *stats)
+{
+    if(stats->peak > total->peak) total->peak = stats->peak;
+    total->spawns += stats->spawns;
+    total->failedSpawns += stats->failedSpawns;
+}
+
+static void
+linuxAddGameStats(PoolStats *totals, GameState *gs)
+{
+    linuxAddPoolStats(totals + 0, &gs->bullets.stats);
+    linuxAddPoolStats(totals + 1, gs->asteroids.classStats + ASTEROID_LARGE);
+    linuxAddPoolStats(totals + 2, gs->asteroids.classStats + ASTEROID_SMALL);
+}
+
+static void
+linuxPrintGameStats(PoolStats *totals, GameConfig *config)
+{
+    const char *names[] = { "bullets:", "large:", "small:" };
+    int capacities[] = { config->bulletCapacity, config->largeAsteroidCapacity, config->smallAsteroidCapacity };
+    for(int i = 0;
+        i < 3;
+        i++)
+    {
+        printf("%-11s peak %d/%d, %lld spawned, %lld failed\n", names[i], totals[i].peak, capacities[i],
+               totals[i].spawns, totals[i].failedSpawns);
+    }
+}
+
+static Arena
+linuxAllocArena(size_t size, int pageFlags = ARENA_PAGES_DEFAULT)
+{
+    Arena arena;
+    if(!arena_reserve(&arena, size, pageFlags))
+    {
+        fprintf(stderr, "could not reserve %llu MB of address space\n", (unsigned long long)(size / MEGABYTES(1)));
+        exit(1);
+    }
+    return(arena);
+}
+
+static void
+linuxFreeArena(Arena *arena)
+{
+    arena_release(arena);
+}
+
+#include "linux_sessions.cpp"
+
+static void
+linuxRunSingle(long long frameCount)
+{
+    Arena arena = linuxAllocArena(MEGABYTES(64));
+    Arena transient = linuxAllocArena(MEGABYTES(64));
+    
+    GameConfig config = defaultGameConfig();
+    GameState *gs = initializeGame(&arena, &transient, 1, &config);
+    
+    long long gamesPlayed = 1;
+    PoolStats totals[3] = {};
+    
+    double start = linuxGetSeconds();
+    for(long long frame = 0;
+        frame < frameCount;
+        frame++)
+    {
+        GameInput input = linuxBotInput(frame);
+        GameUpdate(gs, &input, SIM_DT);
+        
+        if(gs->gameOver)
+        {
+            linuxAddGameStats(totals, gs);
+            gs = initializeGame(&arena, &transient, randomNext(&gs->random), &gs->config);
+            gamesPlayed++;
+        }
+    }
+    double elapsed = linuxGetSeconds() - start;
+    linuxAddGameStats(totals, gs);
+    
+    printf("frames:     %lld\n", frameCount);
+    printf("games:      %lld\n", gamesPlayed);
+    printf("seconds:    %.3f\n", elapsed);
+    printf("sim fps:    %.0f (%.0fx realtime at %d Hz)\n", frameCount / elapsed, frameCount / (elapsed * SIM_HZ), SIM_HZ);
+    printf("ns/frame:   %.1f\n", (elapsed * 1000000000.0) / frameCount);
+    printf("permanent:  %llu bytes\n", (unsigned long long)arena.highWater);
+    printf("transient:  %llu bytes high water\n", (unsigned long long)transient.highWater);
+    linuxPrintGameStats(totals, &config);
+    
+    linuxFreeArena(&transient);
+    linuxFreeArena(&arena);
+}
+
+// Steps N games with the transposed GameBatch and, for reference, N separate
+// GameStates with GameUpdate. Both get the same scripted input.
+static void
+linuxRunBatch(long long gameTicks)
+{
+    int gameCounts[] = { 1, 64, 1024, 16384 };
+    
+    printf("%8s %10s %18s %18s %8s\n", "games", "ticks", "batch ticks/s", "scalar ticks/s", "speedup");
+    for(int n = 0;
+        n < (int)(sizeof(gameCounts) / sizeof(gameCounts[0]));
+        n++)
+    {
+        int gameCount = gameCounts[n];
+        long long tickCount = gameTicks / gameCount;
+        if(tickCount < 600) tickCount = 600;
+        
+        // NOTE(trist007): games start empty, give them a few seconds of play
+        // to fill up with asteroids and bullets before timing
+        long long warmupTicks = 5 * SIM_HZ;
+        
+        Arena arena = linuxAllocArena(MEGABYTES(512));
+        GameInput *inputs = arena_push_array(&arena, GameInput, gameCount);
+        Assert(inputs);
+        
+        // Batched
+        GameBatch *batch = initializeGameBatch(&arena, gameCount, 1);
+        Assert(batch);
+        double start = 0;
+        for(long long tick = 0;
+            tick < warmupTicks + tickCount;
+            tick++)
+        {
+            if(tick == warmupTicks) start = linuxGetSeconds();
+            
+            for(int game = 0;
+                game < gameCount;
+                game++)
+            {
+                inputs[game] = linuxBotInput(tick, game);
+            }
+            GameBatchUpdate(batch, inputs, SIM_DT);
+        }
+        double batchSeconds = linuxGetSeconds() - start;
+        
+        // One GameState per game, all in the same arena, sharing one
+        // scratch arena since they run one after another
+        Arena transient = arena_sub(&arena, MEGABYTES(1));
+        GameConfig config = defaultGameConfig();
+        GameState **games = arena_push_array(&arena, GameState *, gameCount);
+        Assert(games && transient.base);
+        for(int game = 0;
+            game < gameCount;
+            game++)
+        {
+            games[game] = pushGameState(&arena, &config);
+            initializeGameState(games[game], &transient, 1 + game);
+        }
+        for(long long tick = 0;
+            tick < warmupTicks + tickCount;
+            tick++)
+        {
+            if(tick == warmupTicks) start = linuxGetSeconds();
+            
+            for(int game = 0;
+                game < gameCount;
+                game++)
+            {
+                inputs[game] = linuxBotInput(tick, game);
+                GameUpdate(games[game], inputs + game, SIM_DT);
+                if(games[game]->gameOver) initializeGameState(games[game], &transient, randomNext(&games[game]->random));
+            }
+        }
+        double scalarSeconds = linuxGetSeconds() - start;
+        
+        double total = (double)tickCount * gameCount;
+        printf("%8d %10lld %18.0f %18.0f %7.2fx\n", gameCount, tickCount,
+               total / batchSeconds, total / scalarSeconds, scalarSeconds / batchSeconds);
+        
+        linuxFreeArena(&arena);
+    }
+}
+
+// dTLB load misses for this thread, -1 when perf events aren't allowed
+static int
+linuxOpenTlbMissCounter(void)
+{
+    struct perf_event_attr attr = {};
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    return(fd);
+}
+
+// Same batch world backed three ways. Commit grows on demand so the
+// reservation can be far bigger than what the world ends up touching.
+static void
+linuxRunArena(int gameCount, long long tickCount)
+{
+    const char *modeNames[] = { "4 KB", "THP", "hugetlb" };
+    int modeFlags[] = { ARENA_PAGES_DEFAULT, ARENA_PAGES_TRANSPARENT_HUGE, ARENA_PAGES_EXPLICIT_HUGE };
+    
+    printf("%d games x %lld ticks, %llu GB reserved per arena\n", gameCount, tickCount, GIGABYTES(16) / GIGABYTES(1));
+    printf("%8s %10s %16s %14s %14s %10s\n", "pages", "seconds", "game ticks/s", "dTLB misses", "committed MB", "huge MB");
+    for(int mode = 0;
+        mode < 3;
+        mode++)
+    {
+        Arena arena = linuxAllocArena(GIGABYTES(16), modeFlags[mode]);
+        GameInput *inputs = arena_push_array(&arena, GameInput, gameCount);
+        Assert(inputs);
+        
+        GameBatch *batch = initializeGameBatch(&arena, gameCount, 1);
+        Assert(batch);
+        
+        int counter = linuxOpenTlbMissCounter();
+        if(counter >= 0)
+        {
+            ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+            ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        
+        double start = linuxGetSeconds();
+        for(long long tick = 0;
+            tick < tickCount;
+            tick++)
+        {
+            for(int game = 0;
+                game < gameCount;
+                game++)
+            {
+                inputs[game] = linuxBotInput(tick, game);
+            }
+            GameBatchUpdate(batch, inputs, SIM_DT);
+        }
+        double elapsed = linuxGetSeconds() - start;
+        
+        char misses[32] = "n/a";
+        if(counter >= 0)
+        {
+            ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+            long long count = 0;
+            if(read(counter, &count, sizeof(count)) == sizeof(count))
+            {
+                snprintf(misses, sizeof(misses), "%lld", count);
+            }
+            close(counter);
+        }
+        
+        printf("%8s %10.3f %16.0f %14s %14.1f %10.1f\n", modeNames[mode], elapsed,
+               (double)gameCount * tickCount / elapsed, misses,
+               (double)arena.committed / MEGABYTES(1), (double)arena.hugeCommitted / MEGABYTES(1));
+        
+        linuxFreeArena(&arena);
+    }
+}
+
+static void
+linuxTickSnapshotGames(GameState **games, int gameCount, int touched, long long frame)
+{
+    for(int i = 0;
+        i < touched;
+        i++)
+    {
+        int game = (int)((frame * touched + i) % gameCount);
+        GameInput input = linuxBotInput(frame, game);
+        GameState *gs = games[game];
+        GameUpdate(gs, &input, SIM_DT);
+        if(gs->gameOver) initializeGameState(gs, gs->transient, randomNext(&gs->random));
+    }
+}
+
+// A search-like load: lots of games in one arena, a few of them advance
+// between saves. Full copies against dirty pages, then restores are checked
+// byte for byte against copies taken at save time.
+static void
+linuxRunSnapshot(int gameCount, long long saveCount, int touched)
+{
+    const char *modeNames[] = { "full", "dirty" };
+    int slotCount = SIM_HZ / 2;
+    GameConfig config = defaultGameConfig();
+    
+    printf("%d games (%.1f MB), %d touched per save, %d slot ring\n", gameCount,
+           (double)gameCount * gameStateSize(&config) / MEGABYTES(1), touched, slotCount);
+    printf("%6s %12s %14s %12s %14s %10s\n", "mode", "saves/s", "KB/save", "restores/s", "storage MB", "check");
+    for(int mode = SNAPSHOT_FULL_COPY;
+        mode <= SNAPSHOT_DIRTY_PAGES;
+        mode++)
+    {
+        Arena arena = linuxAllocArena(GIGABYTES(1));
+        Arena transient = linuxAllocArena(MEGABYTES(64));
+        Arena storage = linuxAllocArena(GIGABYTES(64));
+        
+        GameState **games = arena_push_array(&arena, GameState *, gameCount);
+        Assert(games);
+        for(int game = 0;
+            game < gameCount;
+            game++)
+        {
+            games[game] = pushGameState(&arena, &config);
+            Assert(games[game]);
+            initializeGameState(games[game], &transient, 1 + game);
+        }
+        
+        SnapshotRing *ring = initializeSnapshotRing(&storage, &arena, slotCount, arena.used, mode);
+        Assert(ring);
+        
+        unsigned char *checkCopy = (unsigned char *)malloc(arena.used);
+        unsigned char *lastCopy = (unsigned char *)malloc(arena.used);
+        long long checkAt = saveCount - slotCount / 2;
+        if(checkAt < 0) checkAt = 0;
+        
+        double start = linuxGetSeconds();
+        for(long long frame = 0;
+            frame < saveCount;
+            frame++)
+        {
+            linuxTickSnapshotGames(games, gameCount, touched, frame);
+            saveSnapshot(ring, frame);
+            if(frame == checkAt) memcpy(checkCopy, arena.base, arena.used);
+        }
+        double saveSeconds = linuxGetSeconds() - start;
+        unsigned long long saveBytes = ring->bytesCopied;
+        memcpy(lastCopy, arena.base, arena.used);
+        
+        // Roll back into the middle of the ring, then wander off and jump
+        // back to the newest
+        bool ok = restoreSnapshot(ring, (int)(saveCount - 1 - checkAt)) && memcmp(arena.base, checkCopy, arena.used) == 0;
+        linuxTickSnapshotGames(games, gameCount, touched, saveCount);
+        ok = ok && restoreSnapshot(ring, 0) && memcmp(arena.base, lastCopy, arena.used) == 0;
+        
+        long long restoreCount = saveCount;
+        start = linuxGetSeconds();
+        for(long long i = 0;
+            i < restoreCount;
+            i++)
+        {
+            linuxTickSnapshotGames(games, gameCount, touched, i);
+            restoreSnapshot(ring, (int)(i % ring->count));
+        }
+        double restoreSeconds = linuxGetSeconds() - start;
+        
+        printf("%6s %12.0f %14.1f %12.0f %14.1f %10s\n", modeNames[ring->mode], saveCount / saveSeconds,
+               (double)saveBytes / saveCount / 1024.0, restoreCount / restoreSeconds,
+               (double)storage.used / MEGABYTES(1), ok ? "ok" : "FAILED");
+        
+        free(lastCopy);
+        free(checkCopy);
+        releaseSnapshotRing(ring);
+        linuxFreeArena(&storage);
+        linuxFreeArena(&transient);
+        linuxFreeArena(&arena);
+    }
+}
+
+// Every game owns its generator, so the same seed has to give the same run
+// byte for byte, and the SIMD lane fill has to match the scalar series
+static void
+linuxRunRandom(int laneCount, long long rounds)
+{
+    laneCount = (laneCount + BATCH_LANE_WIDTH - 1) & ~(BATCH_LANE_WIDTH - 1);
+    Arena arena = linuxAllocArena(GIGABYTES(1));
+    Arena transient = linuxAllocArena(MEGABYTES(64));
+    
+    // Replays: same seed, same inputs, identical state
+    GameConfig config = defaultGameConfig();
+    size_t runBytes[2];
+    unsigned char *runs[2];
+    for(int run = 0;
+        run < 2;
+        run++)
+    {
+        GameState *gs = initializeGame(&arena, &transient, 7, &config);
+        for(long long frame = 0;
+            frame < 60 * SIM_HZ;
+            frame++)
+        {
+            GameInput input = linuxBotInput(frame);
+            GameUpdate(gs, &input, SIM_DT);
+            if(gs->gameOver) gs = initializeGame(&arena, &transient, randomNext(&gs->random), &gs->config);
+        }
+        runBytes[run] = arena.used;
+        runs[run] = (unsigned char *)malloc(arena.used);
+        memcpy(runs[run], arena.base, arena.used);
+    }
+    bool replayOk = runBytes[0] == runBytes[1] && memcmp(runs[0], runs[1], runBytes[0]) == 0;
+    free(runs[1]);
+    free(runs[0]);
+    
+    bool batchOk = true;
+    size_t batchBytes = 0;
+    unsigned char *firstBatch = 0;
+    for(int run = 0;
+        run < 2;
+        run++)
+    {
+        arena_reset(&arena);
+        GameBatch *batch = initializeGameBatch(&arena, 256, 7);
+        Assert(batch);
+        GameInput *inputs = arena_push_array(&arena, GameInput, 256);
+        Assert(inputs);
+        for(long long tick = 0;
+            tick < 10 * SIM_HZ;
+            tick++)
+        {
+            for(int game = 0;
+                game < 256;
+                game++)
+            {
+                inputs[game] = linuxBotInput(tick, game);
+            }
+            GameBatchUpdate(batch, inputs, SIM_DT);
+        }
+        if(run == 0)
+        {
+            batchBytes = arena.used;
+            firstBatch = (unsigned char *)malloc(batchBytes);
+            memcpy(firstBatch, arena.base, batchBytes);
+        }
+        else
+        {
+            batchOk = batchBytes == arena.used && memcmp(firstBatch, arena.base, batchBytes) == 0;
+        }
+    }
+    free(firstBatch);
+    
+    // Lane fill against one scalar series per lane, with half the lanes
+    // masked off every other round
+    arena_reset(&arena);
+    GameBatch *batch = initializeGameBatch(&arena, laneCount, 11);
+    Assert(batch);
+    RandomSeries *series = arena_push_array(&arena, RandomSeries, laneCount);
+    int *mask = arena_push_array(&arena, int, laneCount);
+    unsigned int *out = arena_push_array(&arena, unsigned int, laneCount);
+    Assert(series && mask && out);
+    for(int lane = 0;
+        lane < laneCount;
+        lane++)
+    {
+        series[lane] = seedRandomSeries(11 + lane);
+    }
+    
+    bool laneOk = true;
+    for(int round = 0;
+        round < 64;
+        round++)
+    {
+        for(int lane = 0;
+            lane < laneCount;
+            lane++)
+        {
+            mask[lane] = (round & 1) ? (lane & 1) : 1;
+        }
+        batchRandomFill(&batch->random, mask, out, laneCount);
+        for(int lane = 0;
+            lane < laneCount;
+            lane++)
+        {
+            if(mask[lane] && out[lane] != randomNext(series + lane)) laneOk = false;
+        }
+    }
+    
+    for(int lane = 0;
+        lane < laneCount;
+        lane++)
+    {
+        mask[lane] = 1;
+    }
+    
+    unsigned int sink = 0;
+    double start = linuxGetSeconds();
+    for(long long round = 0;
+        round < rounds;
+        round++)
+    {
+        for(int lane = 0;
+            lane < laneCount;
+            lane++)
+        {
+            out[lane] = randomNext(series + lane);
+        }
+        sink += out[round % laneCount];
+    }
+    double scalarSeconds = linuxGetSeconds() - start;
+    
+    start = linuxGetSeconds();
+    for(long long round = 0;
+        round < rounds;
+        round++)
+    {
+        batchRandomFill(&batch->random, mask, out, laneCount);
+        sink += out[round % laneCount];
+    }
+    double laneSeconds = linuxGetSeconds() - start;
+    
+    double numbers = (double)laneCount * rounds;
+    printf("replay:     %s\n", replayOk ? "bit-exact" : "DIVERGED");
+    printf("batch:      %s\n", batchOk ? "bit-exact" : "DIVERGED");
+    printf("lane fill:  %s\n", laneOk ? "matches scalar" : "MISMATCH");
+    printf("scalar:     %.0f M numbers/s\n", numbers / scalarSeconds / 1000000.0);
+    printf("lane fill:  %.0f M numbers/s (%.2fx)\n", numbers / laneSeconds / 1000000.0, scalarSeconds / laneSeconds);
+    linuxBenchmarkSink = sink;
+    
+    linuxFreeArena(&transient);
+    linuxFreeArena(&arena);
+}
+
+// Record a stretch of bot play mid game, then loop it. Every loop has to end
+// on exactly the state the recording ended on.
+static void
+linuxRunReplay(long long tickCount, int loopCount)
+{
+    Arena arena = linuxAllocArena(MEGABYTES(64));
+    Arena transient = linuxAllocArena(MEGABYTES(64));
+    Arena storage = linuxAllocArena(GIGABYTES(1));
+    
+    GameConfig config = defaultGameConfig();
+    GameState *gs = initializeGame(&arena, &transient, 3, &config);
+    long long frame = 0;
+    for(;
+        frame < 5 * SIM_HZ;
+        frame++)
+    {
+        GameInput input = linuxBotInput(frame);
+        GameUpdate(gs, &input, SIM_DT);
+        if(gs->gameOver) gs = initializeGame(&arena, &transient, randomNext(&gs->random), &gs->config);
+    }
+    
+    InputReplay replay;
+    initializeReplay(&replay, &arena, &storage);
+    beginRecording(&replay);
+    for(long long tick = 0;
+        tick < tickCount;
+        tick++, frame++)
+    {
+        GameInput input = linuxBotInput(frame);
+        recordInput(&replay, &input);
+        GameUpdate(gs, &input, SIM_DT);
+        if(gs->gameOver) gs = initializeGame(&arena, &transient, randomNext(&gs->random), &gs->config);
+    }
+    
+    size_t endUsed = arena.used;
+    unsigned char *endState = (unsigned char *)malloc(endUsed);
+    memcpy(endState, arena.base, endUsed);
+    
+    int mismatches = 0;
+    beginPlayback(&replay);
+    double start = linuxGetSeconds();
+    for(int loop = 0;
+        loop < loopCount;
+        loop++)
+    {
+        for(long long tick = 0;
+            tick < tickCount;
+            tick++)
+        {
+            GameInput input = {};
+            playbackInput(&replay, &input);
+            GameUpdate(gs, &input, SIM_DT);
+            if(gs->gameOver) gs = initializeGame(&arena, &transient, randomNext(&gs->random), &gs->config);
+        }
+        if(arena.used != endUsed || memcmp(arena.base, endState, endUsed) != 0) mismatches++;
+    }
+    double elapsed = linuxGetSeconds() - start;
+    endReplay(&replay);
+    
+    long long ticks = tickCount * loopCount;
+    printf("recorded:   %lld ticks, %llu bytes\n", tickCount, (unsigned long long)storage.used);
+    printf("played:     %d loops, %lld ticks\n", loopCount, ticks);
+    printf("ns/tick:    %.1f\n", (elapsed * 1000000000.0) / ticks);
+    printf("check:      %s\n", mismatches ? "DIVERGED" : "every loop matches the recording");
+    
+    free(endState);
+    linuxFreeArena(&storage);
+    linuxFreeArena(&transient);
+    linuxFreeArena(&arena);
+}
+
+// The asteroid layout before it went SoA, kept for the comparison below
+typedef struct
+{
+    Vector2 pos;
+    Vector2 prevPos;
+    Vector2 velocity;
+    Vector2 direction;
+    int size;
+    bool active;
+} LinuxAsteroidAoS;
+
+// Movement + despawn and bullet distance passes over count asteroids, the
+// old array of structs loops against the dense SoA pool GameUpdate uses now.
+// Both are timed per asteroid spawned, the pool only pays for the live ones.
+static void
+linuxRunSoA(int count, int tickCount)
+{
+    int bulletCount = DEFAULT_BULLET_CAPACITY;
+    Arena arena = linuxAllocArena(GIGABYTES(1));
+    
+    LinuxAsteroidAoS *aos = arena_push_array(&arena, LinuxAsteroidAoS, count);
+    AsteroidPool pool;
+    bool pushed = pushAsteroidPool(&arena, &pool, count);
+    int *hit = arena_push_array(&arena, int, count);
+    Vector2 *bullets = arena_push_array(&arena, Vector2, bulletCount);
+    Assert(aos && pushed && hit && bullets);
+    
+    float margin = 200.0f;
+    pool.classMargin[ASTEROID_LARGE] = pool.classMargin[ASTEROID_SMALL] = margin;
+    
+    RandomSeries series = seedRandomSeries(5);
+    for(int i = 0;
+        i < count;
+        i++)
+    {
+        int a = addAsteroid(&pool, ASTEROID_LARGE);
+        pool.x[a] = pool.prevX[a] = (float)randomRange(&series, 0, screenWidth);
+        pool.y[a] = pool.prevY[a] = (float)randomRange(&series, 0, screenHeight);
+        pool.vx[a] = (float)randomRange(&series, -60, 60);
+        pool.vy[a] = (float)randomRange(&series, -60, 60);
+        pool.radius[a] = (float)randomRange(&series, 5, 80);
+        
+        aos[i].pos = { pool.x[a], pool.y[a] };
+        aos[i].prevPos = aos[i].pos;
+        aos[i].velocity = { pool.vx[a], pool.vy[a] };
+        aos[i].direction = Vector2Normalize(aos[i].velocity);
+        aos[i].size = (int)pool.radius[a];
+        aos[i].active = true;
+    }
+    
+    float bulletRadius = 3.0f;
+    long long aosHits = 0;
+    long long soaHits = 0;
+    
+    double start = linuxGetSeconds();
+    for(int tick = 0;
+        tick < tickCount;
+        tick++)
+    {
+        for(int i = 0;
+            i < count;
+            i++)
+        {
+            if(aos[i].active)
+            {
+                aos[i].prevPos = aos[i].pos;
+                aos[i].pos.x += aos[i].velocity.x * SIM_DT;
+                aos[i].pos.y += aos[i].velocity.y * SIM_DT;
+                if(aos[i].pos.x < -margin || aos[i].pos.x > screenWidth + margin ||
+                   aos[i].pos.y < -margin || aos[i].pos.y > screenHeight + margin)
+                {
+                    aos[i].active = false;
+                }
+            }
+        }
+    }
+    double aosMove = linuxGetSeconds() - start;
+    
+    start = linuxGetSeconds();
+    for(int tick = 0;
+        tick < tickCount;
+        tick++)
+    {
+        moveAsteroids(pool.x, pool.y, pool.prevX, pool.prevY, pool.vx, pool.vy, pool.count, SIM_DT);
+        despawnAsteroids(&pool, (float)screenWidth, (float)screenHeight);
+    }
+    double soaMove = linuxGetSeconds() - start;
+    
+    // Distance pass: a full magazine of bullets against every asteroid
+    for(int b = 0;
+        b < bulletCount;
+        b++)
+    {
+        bullets[b] = { (float)randomRange(&series, 0, screenWidth), (float)randomRange(&series, 0, screenHeight) };
+    }
+    
+    start = linuxGetSeconds();
+    for(int tick = 0;
+        tick < tickCount;
+        tick++)
+    {
+        for(int b = 0;
+            b < bulletCount;
+            b++)
+        {
+            for(int i = 0;
+                i < count;
+                i++)
+            {
+                if(aos[i].active && Vector2Distance(bullets[b], aos[i].pos) < aos[i].size + bulletRadius) aosHits++;
+            }
+        }
+    }
+    double aosDistance = linuxGetSeconds() - start;
+    
+    start = linuxGetSeconds();
+    for(int tick = 0;
+        tick < tickCount;
+        tick++)
+    {
+        for(int b = 0;
+            b < bulletCount;
+            b++)
+        {
+            soaHits += overlapAsteroids(pool.x, pool.y, pool.radius, pool.count, bullets[b].x, bullets[b].y, bulletRadius, hit);
+        }
+    }
+    double soaDistance = linuxGetSeconds() - start;
+    
+    int aosActive = 0;
+    for(int i = 0;
+        i < count;
+        i++)
+    {
+        aosActive += aos[i].active;
+    }
+    int soaActive = pool.count;
+    
+    double moved = (double)count * tickCount;
+    double tested = moved * bulletCount;
+    printf("%d asteroids x %d ticks, %d bullets\n", count, tickCount, bulletCount);
+    printf("%10s %16s %20s\n", "layout", "move ns/ast", "distance ns/ast/bullet");
+    printf("%10s %16.3f %20.3f\n", "AoS", aosMove * 1e9 / moved, aosDistance * 1e9 / tested);
+    printf("%10s %16.3f %20.3f\n", "dense SoA", soaMove * 1e9 / moved, soaDistance * 1e9 / tested);
+    printf("speedup    %15.2fx %19.2fx\n", aosMove / soaMove, aosDistance / soaDistance);
+    printf("check:     %d/%d live, %lld/%lld hits\n", aosActive, soaActive, aosHits, soaHits);
+    
+    linuxFreeArena(&arena);
+}
+
+// Checks overlapAsteroidsMask against the scalar overlapAsteroids, and the
+// swept kernel against sweptCircleHit, on random ranges starting anywhere in
+// the arrays and with circles set up to touch exactly. Then times them and
+// the old Vector2Distance test in ns per pair.
+static void
+linuxRunNarrowphase(int count, int rounds)
+{
+    int bulletCount = 64;
+    int checkSize = 300;
+    Arena arena = linuxAllocArena(GIGABYTES(1));
+    
+    int slots = ASTEROID_POOL_SLOTS(count > checkSize + 8 ? count : checkSize + 8);
+    float *x = arena_push_array(&arena, float, slots);
+    float *y = arena_push_array(&arena, float, slots);
+    float *radius = arena_push_array(&arena, float, slots);
+    float *prevX = arena_push_array(&arena, float, slots);
+    float *prevY = arena_push_array(&arena, float, slots);
+    int *hit = arena_push_array(&arena, int, slots);
+    unsigned long long *hitMask = arena_push_array(&arena, unsigned long long, MASK_WORDS(slots));
+    Vector2 *bullets = arena_push_array(&arena, Vector2, bulletCount);
+    Assert(x && y && radius && prevX && prevY && hit && hitMask && bullets);
+    
+    const char *kernelNames[] = { "", "scalar", "", "", "SSE2", "", "", "", "AVX2" };
+    printf("kernel:     %s, %d lanes\n", kernelNames[NARROWPHASE_LANES], NARROWPHASE_LANES);
+    
+    RandomSeries series = seedRandomSeries(18);
+    int trials = 20000;
+    int mismatches = 0;
+    int sweptMismatches = 0;
+    long long checkedHits = 0;
+    long long sweptHits = 0;
+    for(int trial = 0;
+        trial < trials;
+        trial++)
+    {
+        int offset = randomRange(&series, 0, 7);
+        int n = randomRange(&series, 0, checkSize);
+        float px = (float)randomRange(&series, 0, 200);
+        float py = (float)randomRange(&series, 0, 200);
+        float r = (float)randomRange(&series, 1, 20);
+        for(int i = offset;
+            i < offset + n;
+            i++)
+        {
+            if(i % 5 == 0)
+            {
+                // 3 4 5 triangle, centres exactly the two radii apart
+                int k = randomRange(&series, 5, 20);
+                x[i] = px + 3.0f * k;
+                y[i] = py + 4.0f * k;
+                radius[i] = 5.0f * k - r;
+            }
+            else
+            {
+                x[i] = (float)randomRange(&series, 0, 200);
+                y[i] = (float)randomRange(&series, 0, 200);
+                radius[i] = (float)randomRange(&series, 1, 40);
+            }
+            prevX[i] = x[i] - (float)randomRange(&series, -20, 20);
+            prevY[i] = y[i] - (float)randomRange(&series, -20, 20);
+        }
+        
+        int scalarCount = overlapAsteroids(x + offset, y + offset, radius + offset, n, px, py, r, hit);
+        int maskCount = overlapAsteroidsMask(x + offset, y + offset, radius + offset, n, px, py, r, hitMask);
+        bool same = scalarCount == maskCount;
+        for(int i = 0;
+            i < MASK_WORDS(n) * 64;
+            i++)
+        {
+            int bit = (int)((hitMask[i / 64] >> (i % 64)) & 1);
+            same = same && bit == (i < n ? hit[i] : 0);
+        }
+        mismatches += !same;
+        checkedHits += scalarCount;
+        
+        // The circle moves too, up to a few times further than the asteroids
+        float toX = px + (float)randomRange(&series, -60, 60);
+        float toY = py + (float)randomRange(&series, -60, 60);
+        int sweptCount = sweptOverlapAsteroidsMask(x + offset, y + offset, prevX + offset, prevY + offset,
+                                                   radius + offset, n, px, py, toX, toY, r, hitMask);
+        int scalarSwept = 0;
+        same = true;
+        for(int i = 0;
+            i < MASK_WORDS(n) * 64;
+            i++)
+        {
+            int expected = 0;
+            if(i < n)
+            {
+                int a = offset + i;
+                expected = sweptCircleHit(px, py, toX - px, toY - py, x[a], y[a], prevX[a], prevY[a], radius[a] + r);
+            }
+            scalarSwept += expected;
+            same = same && (int)((hitMask[i / 64] >> (i % 64)) & 1) == expected;
+        }
+        sweptMismatches += !same || sweptCount != scalarSwept;
+        sweptHits += scalarSwept;
+    }
+    printf("check:      %d ranges, %lld hits, %s\n", trials, checkedHits,
+           mismatches ? "MISMATCH" : "every mask matches scalar");
+    printf("swept:      %d ranges, %lld hits, %s\n", trials, sweptHits,
+           sweptMismatches ? "MISMATCH" : "every mask matches scalar");
+    
+    for(int i = 0;
+        i < count;
+        i++)
+    {
+        x[i] = (float)randomRange(&series, 0, screenWidth);
+        y[i] = (float)randomRange(&series, 0, screenHeight);
+        radius[i] = (float)randomRange(&series, 5, 80);
+        prevX[i] = x[i] - (float)randomRange(&series, -5, 5);
+        prevY[i] = y[i] - (float)randomRange(&series, -5, 5);
+    }
+    for(int b = 0;
+        b < bulletCount;
+        b++)
+    {
+        bullets[b] = { (float)randomRange(&series, 0, screenWidth), (float)randomRange(&series, 0, screenHeight) };
+    }
+    float bulletRadius = 3.0f;
+    
+    long long distanceHits = 0;
+    double start = linuxGetSeconds();
+    for(int round = 0;
+        round < rounds;
+        round++)
+    {
+        for(int b = 0;
+            b < bulletCount;
+            b++)
+        {
+            for(int i = 0;
+                i < count;
+                i++)
+            {
+                Vector2 center = { x[i], y[i] };
+                if(Vector2Distance(bullets[b], center) < radius[i] + bulletRadius) distanceHits++;
+            }
+        }
+    }
+    double distanceSeconds = linuxGetSeconds() - start;
+    
+    long long scalarHits = 0;
+    start = linuxGetSeconds();
+    for(int round = 0;
+        round < rounds;
+        round++)
+    {
+        for(int b = 0;
+            b < bulletCount;
+            b++)
+        {
+            scalarHits += overlapAsteroids(x, y, radius, count, bullets[b].x, bullets[b].y, bulletRadius, hit);
+        }
+    }
+    double scalarSeconds = linuxGetSeconds() - start;
+    
+    long long maskHits = 0;
+    start = linuxGetSeconds();
+    for(int round = 0;
+        round < rounds;
+        round++)
+    {
+        for(int b = 0;
+            b < bulletCount;
+            b++)
+        {
+            maskHits += overlapAsteroidsMask(x, y, radius, count, bullets[b].x, bullets[b].y, bulletRadius, hitMask);
+        }
+    }
+    double maskSeconds = linuxGetSeconds() - start;
+    
+    long long sweptMaskHits = 0;
+    start = linuxGetSeconds();
+    for(int round = 0;
+        round < rounds;
+        round++)
+    {
+        for(int b = 0;
+            b < bulletCount;
+            b++)
+        {
+            sweptMaskHits += sweptOverlapAsteroidsMask(x, y, prevX, prevY, radius, count, bullets[b].x - 5.0f,
+                                                       bullets[b].y, bullets[b].x, bullets[b].y, bulletRadius, hitMask);
+        }
+    }
+    double sweptSeconds = linuxGetSeconds() - start;
+    
+    // NOTE(trist007): the kernels alone do the same compares, what differs
+    // is the answer, an int per asteroid against a bit. Callers have to find
+    // the hits in it, so time that as well: scanning hit against walking the
+    // set bits.
+    int *hitList = arena_push_array(&arena, int, slots);
+    Assert(hitList);
+    long long scalarGathered = 0;
+    start = linuxGetSeconds();
+    for(int round = 0;
+        round < rounds;
+        round++)
+    {
+        for(int b = 0;
+            b < bulletCount;
+            b++)
+        {
+            overlapAsteroids(x, y, radius, count, bullets[b].x, bullets[b].y, bulletRadius, hit);
+            int found = 0;
+            for(int i = 0;
+                i < count;
+                i++)
+            {
+                hitList[found] = i;
+                found += hit[i];
+            }
+            scalarGathered += found;
+        }
+    }
+    double scalarGatherSeconds = linuxGetSeconds() - start;
+    
+    long long maskGathered = 0;
+    start = linuxGetSeconds();
+    for(int round = 0;
+        round < rounds;
+        round++)
+    {
+        for(int b = 0;
+            b < bulletCount;
+            b++)
+        {
+            overlapAsteroidsMask(x, y, radius, count, bullets[b].x, bullets[b].y, bulletRadius, hitMask);
+            int found = 0;
+            for(int word = 0;
+                word < MASK_WORDS(count);
+                word++)
+            {
+                unsigned long long bits = hitMask[word];
+                while(bits)
+                {
+                    hitList[found++] = word * 64 + findLeastSignificantSetBit(bits);
+                    bits &= bits - 1;
+                }
+            }
+            maskGathered += found;
+        }
+    }
+    double maskGatherSeconds = linuxGetSeconds() - start;
+    linuxBenchmarkSink = hitList[0];
+    
+    double pairs = (double)count * bulletCount * rounds;
+    printf("%d asteroids x %d bullets x %d rounds\n", count, bulletCount, rounds);
+    printf("%28s %10s %10s\n", "test", "ns/pair", "speedup");
+    printf("%28s %10.3f %9.2fx\n", "Vector2Distance", distanceSeconds * 1e9 / pairs, 1.0);
+    printf("%28s %10.3f %9.2fx\n", "overlapAsteroids", scalarSeconds * 1e9 / pairs, distanceSeconds / scalarSeconds);
+    printf("%28s %10.3f %9.2fx\n", "overlapAsteroidsMask", maskSeconds * 1e9 / pairs, distanceSeconds / maskSeconds);
+    printf("%28s %10.3f %9.2fx\n", "sweptOverlapAsteroidsMask", sweptSeconds * 1e9 / pairs,
+           distanceSeconds / sweptSeconds);
+    printf("%28s %10.3f %9.2fx\n", "overlapAsteroids + list", scalarGatherSeconds * 1e9 / pairs,
+           distanceSeconds / scalarGatherSeconds);
+    printf("%28s %10.3f %9.2fx\n", "overlapAsteroidsMask + list", maskGatherSeconds * 1e9 / pairs,
+           distanceSeconds / maskGatherSeconds);
+    printf("hits:       %lld/%lld/%lld, %lld swept, %lld/%lld listed\n", distanceHits, scalarHits, maskHits,
+           sweptMaskHits, scalarGathered, maskGathered);
+    
+    linuxFreeArena(&arena);
+}
+
+// Churns a pool while holding handles to random asteroids and bullets. Every
+// entity is tagged with a unique number (radius for asteroids, pos.x for
+// bullets) so each lookup can be checked against who it should find, or -1
+// once the entity is gone. Then handle lookups are timed against finding the
+// same asteroid again by searching for its tag.
+static void
+linuxRunHandles(int count, int roundCount)
+{
+    int handleCount = 256;
+    int churn = count / 64 + 1;
+    Arena arena = linuxAllocArena(GIGABYTES(1));
+    
+    AsteroidPool asteroids;
+    BulletPool bullets;
+    bool pushed = pushAsteroidPool(&arena, &asteroids, count) && pushBulletPool(&arena, &bullets, count);
+    AsteroidHandle *asteroidHandles = arena_push_array(&arena, AsteroidHandle, handleCount);
+    BulletHandle *bulletHandles = arena_push_array(&arena, BulletHandle, handleCount);
+    int *asteroidTags = arena_push_array(&arena, int, handleCount);
+    int *bulletTags = arena_push_array(&arena, int, handleCount);
+    
+    // Tags stay exact in a float up to 2^24
+    int maxTags = 2 * (count + roundCount * churn) + 1;
+    Assert(maxTags < (1 << 24));
+    unsigned char *alive = arena_push_array(&arena, unsigned char, maxTags);
+    Assert(pushed && asteroidHandles && bulletHandles && asteroidTags && bulletTags && alive);
+    memset(alive, 0, maxTags);
+    
+    resetBulletPool(&bullets);
+    
+    RandomSeries series = seedRandomSeries(13);
+    int nextTag = 1;
+    for(int i = 0;
+        i < handleCount;
+        i++)
+    {
+        asteroidHandles[i] = {};
+        bulletHandles[i] = {};
+        asteroidTags[i] = 0;
+        bulletTags[i] = 0;
+    }
+    
+    long long checked = 0;
+    long long stale = 0;
+    long long wrong = 0;
+    for(int round = 0;
+        round < roundCount;
+        round++)
+    {
+        // Kill some, then fill back up
+        for(int k = 0;
+            k < churn && asteroids.count > 0;
+            k++)
+        {
+            int i = randomRange(&series, 0, asteroids.count - 1);
+            alive[(int)asteroids.radius[i]] = 0;
+            removeAsteroid(&asteroids, i);
+        }
+        for(int k = 0;
+            k < churn;
+            k++)
+        {
+            int i = randomRange(&series, 0, bullets.capacity - 1);
+            if(bullets.bullet[i].active)
+            {
+                alive[(int)bullets.bullet[i].pos.x] = 0;
+                releaseBullet(&bullets, i);
+            }
+        }
+        while(asteroids.count < asteroids.capacity)
+        {
+            int i = addAsteroid(&asteroids, ASTEROID_LARGE);
+            asteroids.radius[i] = (float)nextTag;
+            alive[nextTag++] = 1;
+        }
+        while(bullets.freeCount > 0 && randomRange(&series, 0, 7))
+        {
+            int i = allocateBullet(&bullets);
+            bullets.bullet[i].pos.x = (float)nextTag;
+            alive[nextTag++] = 1;
+        }
+        
+        // Swap out a few of the held handles for fresh ones
+        for(int k = 0;
+            k < 8;
+            k++)
+        {
+            int h = randomRange(&series, 0, handleCount - 1);
+            int i = randomRange(&series, 0, asteroids.count - 1);
+            asteroidHandles[h] = getAsteroidHandle(&asteroids, i);
+            asteroidTags[h] = (int)asteroids.radius[i];
+            
+            int b = randomRange(&series, 0, bullets.capacity - 1);
+            if(bullets.bullet[b].active)
+            {
+                bulletHandles[h] = getBulletHandle(&bullets, b);
+                bulletTags[h] = (int)bullets.bullet[b].pos.x;
+            }
+        }
+        
+        for(int h = 0;
+            h < handleCount;
+            h++)
+        {
+            int i = lookupAsteroid(&asteroids, asteroidHandles[h]);
+            if(asteroidTags[h] && alive[asteroidTags[h]]) wrong += (i < 0 || (int)asteroids.radius[i] != asteroidTags[h]);
+            else wrong += (i >= 0);
+            
+            int b = lookupBullet(&bullets, bulletHandles[h]);
+            if(bulletTags[h] && alive[bulletTags[h]]) wrong += (b < 0 || (int)bullets.bullet[b].pos.x != bulletTags[h]);
+            else wrong += (b >= 0);
+            
+            stale += (i < 0) + (b < 0);
+            checked += 2;
+        }
+    }
+    
+    // Lookup cost: handle against a search of the live range for the tag
+    int lookups = 1 << 16;
+    long long sink = 0;
+    double start = linuxGetSeconds();
+    for(int k = 0;
+        k < lookups;
+        k++)
+    {
+        sink += lookupAsteroid(&asteroids, asteroidHandles[k % handleCount]);
+    }
+    double handleSeconds = linuxGetSeconds() - start;
+    
+    int searches = lookups / 64;
+    start = linuxGetSeconds();
+    for(int k = 0;
+        k < searches;
+        k++)
+    {
+        float tag = (float)asteroidTags[k % handleCount];
+        int found = -1;
+        for(int i = 0;
+            i < asteroids.count;
+            i++)
+        {
+            if(asteroids.radius[i] == tag) found = i;
+        }
+        sink += found;
+    }
+    double searchSeconds = linuxGetSeconds() - start;
+    
+    printf("%d asteroids, %d bullets, %d rounds, %d churned per round\n", count, count, roundCount, churn);
+    printf("check:      %lld lookups, %lld stale, %s\n", checked, stale, wrong ? "WRONG" : "all correct");
+    printf("handle:     %.2f ns/lookup\n", handleSeconds * 1e9 / lookups);
+    printf("search:     %.2f ns/lookup (%.0fx)\n", searchSeconds * 1e9 / searches,
+           (searchSeconds / searches) / (handleSeconds / lookups));
+    linuxBenchmarkSink = sink;
+    
+    linuxFreeArena(&arena);
+}
+
+// One bullet update pass over a pool, either testing Bullet.active in
+// every slot or walking the set bits of the active mask
+static void
+linuxMoveBulletsBool(BulletPool *pool, float dt)
+{
+    for(int i = 0;
+        i < pool->capacity;
+        i++)
+    {
+        Bullet *bullet = pool->bullet + i;
+        if(bullet->active)
+        {
+            bullet->prevPos = bullet->pos;
+            bullet->pos.x += bullet->velocity.x * dt;
+            bullet->pos.y += bullet->velocity.y * dt;
+        }
+    }
+}
+
+static void
+linuxMoveBulletsMask(BulletPool *pool, float dt)
+{
+    for(int word = 0;
+        word < pool->maskWords;
+        word++)
+    {
+        unsigned long long bits = pool->activeMask[word];
+        while(bits)
+        {
+            int i = word * 64 + findLeastSignificantSetBit(bits);
+            bits &= bits - 1;
+            
+            Bullet *bullet = pool->bullet + i;
+            bullet->prevPos = bullet->pos;
+            bullet->pos.x += bullet->velocity.x * dt;
+            bullet->pos.y += bullet->velocity.y * dt;
+        }
+    }
+}
+
+// Both iteration modes over the same pool at several occupancies, live
+// slots picked at random so the bool branch can't learn a pattern
+static void
+linuxRunMask(int capacity, int tickCount)
+{
+    double occupancies[] = { 0.01, 0.05, 0.25, 0.5, 0.9, 1.0 };
+    Arena arena = linuxAllocArena(GIGABYTES(1));
+    
+    printf("%d bullet slots, %d ticks\n", capacity, tickCount);
+    printf("%10s %8s %14s %14s %10s %8s\n", "occupancy", "live", "bool ns/tick", "mask ns/tick", "speedup", "check");
+    for(int n = 0;
+        n < (int)(sizeof(occupancies) / sizeof(occupancies[0]));
+        n++)
+    {
+        arena_reset(&arena);
+        BulletPool pool;
+        bool pushed = pushBulletPool(&arena, &pool, capacity);
+        Vector2 *boolPos = arena_push_array(&arena, Vector2, capacity);
+        Assert(pushed && boolPos);
+        resetBulletPool(&pool);
+        
+        RandomSeries series = seedRandomSeries(17);
+        for(int i = 0;
+            i < capacity;
+            i++)
+        {
+            pool.bullet[i].pos = {};
+            pool.bullet[i].velocity = { (float)randomRange(&series, -600, 600), (float)randomRange(&series, -600, 600) };
+        }
+        
+        // Shuffle the free stack so the live slots land all over the pool
+        for(int i = capacity - 1;
+            i > 0;
+            i--)
+        {
+            int j = randomRange(&series, 0, i);
+            int swap = pool.freeIndex[i];
+            pool.freeIndex[i] = pool.freeIndex[j];
+            pool.freeIndex[j] = swap;
+        }
+        int live = (int)(occupancies[n] * capacity);
+        for(int i = 0;
+            i < live;
+            i++)
+        {
+            allocateBullet(&pool);
+        }
+        
+        double start = linuxGetSeconds();
+        for(int tick = 0;
+            tick < tickCount;
+            tick++)
+        {
+            linuxMoveBulletsBool(&pool, SIM_DT);
+        }
+        double boolSeconds = linuxGetSeconds() - start;
+        
+        // Same ticks again from the start, the mask walk has to land every
+        // bullet on the same bits
+        for(int i = 0;
+            i < capacity;
+            i++)
+        {
+            boolPos[i] = pool.bullet[i].pos;
+            pool.bullet[i].pos = {};
+        }
+        
+        start = linuxGetSeconds();
+        for(int tick = 0;
+            tick < tickCount;
+            tick++)
+        {
+            linuxMoveBulletsMask(&pool, SIM_DT);
+        }
+        double maskSeconds = linuxGetSeconds() - start;
+        
+        bool same = true;
+        for(int i = 0;
+            i < capacity;
+            i++)
+        {
+            same = same && memcmp(&boolPos[i], &pool.bullet[i].pos, sizeof(Vector2)) == 0;
+        }
+        
+        printf("%9.0f%% %8d %14.1f %14.1f %9.2fx %8s\n", occupancies[n] * 100.0, live,
+               boolSeconds * 1e9 / tickCount, maskSeconds * 1e9 / tickCount, boolSeconds / maskSeconds,
+               same ? "ok" : "FAILED");
+    }
+    
+    linuxFreeArena(&arena);
+}
+
+// Keeps a swarm game at full pools: every large slot filled with a pebble
+// somewhere on screen and every bullet flying from a random point
+static void
+linuxFillSwarm(GameState *gs, RandomSeries *series)
+{
+    AsteroidPool *asteroids = &gs->asteroids;
+    while(asteroids->classStats[ASTEROID_LARGE].live < asteroids->classLimit[ASTEROID_LARGE])
+    {
+        int i = addAsteroid(asteroids, ASTEROID_LARGE);
+        if(i < 0) break;
+        
+        asteroids->x[i] = asteroids->prevX[i] = (float)randomRange(series, 0, screenWidth);
+        asteroids->y[i] = asteroids->prevY[i] = (float)randomRange(series, 0, screenHeight);
+        asteroids->vx[i] = (float)randomRange(series, -60, 60);
+        asteroids->vy[i] = (float)randomRange(series, -60, 60);
+        asteroids->radius[i] = (float)randomRange(series, 2, 4);
+    }
+    
+    BulletPool *bullets = &gs->bullets;
+    while(bullets->freeCount > 0)
+    {
+        int i = allocateBullet(bullets);
+        float angle = randomRange(series, 0, 359) * DEG2RAD;
+        Bullet *bullet = bullets->bullet + i;
+        bullet->pos.x = (float)randomRange(series, 0, screenWidth);
+        bullet->pos.y = (float)randomRange(series, 0, screenHeight);
+        bullet->prevPos = bullet->pos;
+        bullet->velocity.x = sinf(angle) * gs->bulletSpeed;
+        bullet->velocity.y = -cosf(angle) * gs->bulletSpeed;
+        bullet->timeLeft = gs->bulletLifetime;
+    }
+}
+
+// Time based version of linuxBotInput, so a bot plays the same at any rate
+static GameInput
+linuxBotInputAt(double seconds, double dt)
+{
+    GameInput input = {};
+    input.rotateRight = true;
+    input.thrust = fmod(seconds, 2.0) < (1.0 / 3.0);
+    input.fire = floor(seconds * 8.0) != floor((seconds - dt) * 8.0);
+    return(input);
+}
+
+// NOTE(trist007): tunnelling check for swept collision. A trial is one
+// bullet fired at one small asteroid in an otherwise empty game. The paths
+// are set up so the closest approach comes 0.15-0.35 s in, well before
+// either leaves the screen, with a miss distance either side of the two
+// radii, so whether it should hit is just whether that distance is inside
+// them. Every trial is played at each tick rate with discrete and with swept
+// collision and the answers that disagree are counted. Then a bot plays a
+// few minutes at each rate to show what the sim costs per simulated second.
+static void
+linuxRunTunnel(int trialCount, float maxSpeedMultiplier)
+{
+    int rates[] = { 120, 60, 30, 20 };
+    int rateCount = (int)(sizeof(rates) / sizeof(rates[0]));
+    
+    GameConfig config = defaultGameConfig();
+    config.bulletCapacity = 1;
+    config.largeAsteroidCapacity = 1;
+    config.smallAsteroidCapacity = 1;
+    Arena arena = linuxAllocArena(gameStateSize(&config));
+    Arena transient = linuxAllocArena(MEGABYTES(1));
+    
+    int missed[4][2] = {};
+    int phantom[4][2] = {};
+    int shouldHit = 0;
+    RandomSeries series = seedRandomSeries(19);
+    for(int trial = 0;
+        trial < trialCount;
+        trial++)
+    {
+        GameState *gs = initializeGame(&arena, &transient, 19, &config);
+        Assert(gs);
+        
+        // Random paths until one fits on screen
+        Vector2 bulletStart, bulletVelocity, asteroidStart, asteroidVelocity;
+        float reach, asteroidRadius;
+        double closestTime, missDistance;
+        for(;;)
+        {
+            float bulletAngle = randomRange(&series, 0, 3599) * 0.1f * DEG2RAD;
+            bulletVelocity = { sinf(bulletAngle) * gs->bulletSpeed, -cosf(bulletAngle) * gs->bulletSpeed };
+            float asteroidAngle = randomRange(&series, 0, 3599) * 0.1f * DEG2RAD;
+            float asteroidSpeed = gs->asteroidSpeed *
+                (1.0f + (maxSpeedMultiplier - 1.0f) * randomRange(&series, 0, 1000) / 1000.0f);
+            asteroidVelocity = { cosf(asteroidAngle) * asteroidSpeed, sinf(asteroidAngle) * asteroidSpeed };
+            asteroidRadius = (float)randomRange(&series, 5, 10);
+            reach = asteroidRadius + gs->bulletRadius;
+            
+            closestTime = 0.15 + 0.2 * randomRange(&series, 0, 1000) / 1000.0;
+            missDistance = 2.0 * reach * randomRange(&series, -1000, 1000) / 1000.0;
+            
+            // Too close to the edge and float rounding decides it, not the test
+            if(fabs(fabs(missDistance) - reach) < 0.05) continue;
+            
+            // Bullet minus asteroid is start + relative * t, closest at closestTime
+            double relativeX = bulletVelocity.x - asteroidVelocity.x;
+            double relativeY = bulletVelocity.y - asteroidVelocity.y;
+            double relativeSpeed = sqrt(relativeX * relativeX + relativeY * relativeY);
+            double startX = -missDistance * relativeY / relativeSpeed - relativeX * closestTime;
+            double startY = missDistance * relativeX / relativeSpeed - relativeY * closestTime;
+            
+            bulletStart = { (float)randomRange(&series, 100, screenWidth - 100),
+                (float)randomRange(&series, 100, screenHeight - 100) };
+            asteroidStart = { bulletStart.x - (float)startX, bulletStart.y - (float)startY };
+            
+            double endTime = closestTime + 0.1;
+            Vector2 bulletEnd = Vector2Add(bulletStart, Vector2Scale(bulletVelocity, (float)endTime));
+            Vector2 asteroidEnd = Vector2Add(asteroidStart, Vector2Scale(asteroidVelocity, (float)endTime));
+            if(bulletEnd.x > 0 && bulletEnd.x < screenWidth && bulletEnd.y > 0 && bulletEnd.y < screenHeight &&
+               asteroidStart.x > 0 && asteroidStart.x < screenWidth && asteroidStart.y > 0 && asteroidStart.y < screenHeight &&
+               asteroidEnd.x > 0 && asteroidEnd.x < screenWidth && asteroidEnd.y > 0 && asteroidEnd.y < screenHeight)
+            {
+                break;
+            }
+        }
+        bool hitExpected = fabs(missDistance) < reach;
+        shouldHit += hitExpected;
+        
+        for(int rate = 0;
+            rate < rateCount;
+            rate++)
+        {
+            for(int swept = 0;
+                swept < 2;
+                swept++)
+            {
+                config.sweptCollision = swept;
+                gs = initializeGame(&arena, &transient, 19, &config);
+                Assert(gs);
+                gs->asteroidSpawnInterval = 1e9f;
+                gs->ship.pos = gs->ship.prevPos = { 5, 5 };
+                
+                AsteroidPool *asteroids = &gs->asteroids;
+                int a = addAsteroid(asteroids, ASTEROID_SMALL);
+                asteroids->x[a] = asteroids->prevX[a] = asteroidStart.x;
+                asteroids->y[a] = asteroids->prevY[a] = asteroidStart.y;
+                asteroids->vx[a] = asteroidVelocity.x;
+                asteroids->vy[a] = asteroidVelocity.y;
+                asteroids->radius[a] = asteroidRadius;
+                
+                int b = allocateBullet(&gs->bullets);
+                gs->bullets.bullet[b].pos = gs->bullets.bullet[b].prevPos = bulletStart;
+                gs->bullets.bullet[b].velocity = bulletVelocity;
+                
+                // Run just past the closest approach, the asteroid is still on
+                // screen then so only a hit can have taken it out
+                float dt = 1.0f / rates[rate];
+                int tickCount = (int)ceil((closestTime + 0.1) / dt) + 1;
+                GameInput input = {};
+                for(int tick = 0;
+                    tick < tickCount;
+                    tick++)
+                {
+                    GameUpdate(gs, &input, dt);
+                    gs->gameOver = false;
+                }
+                
+                bool hit = (asteroids->count == 0);
+                missed[rate][swept] += hitExpected && !hit;
+                phantom[rate][swept] += !hitExpected && hit;
+            }
+        }
+    }
+    config = defaultGameConfig();
+    
+    printf("%d shots at small asteroids up to %.1fx speed, %d should hit\n", trialCount, maxSpeedMultiplier, shouldHit);
+    printf("%6s %10s %10s %12s %12s\n", "Hz", "discrete", "swept", "discrete", "swept");
+    printf("%6s %10s %10s %12s %12s\n", "", "missed", "missed", "false hits", "false hits");
+    for(int rate = 0;
+        rate < rateCount;
+        rate++)
+    {
+        printf("%6d %10d %10d %12d %12d\n", rates[rate], missed[rate][0], missed[rate][1],
+               phantom[rate][0], phantom[rate][1]);
+    }
+    
+    // Cost of a session at each rate with swept collision on
+    double simulatedSeconds = 600.0;
+    config.sweptCollision = true;
+    linuxFreeArena(&arena);
+    arena = linuxAllocArena(gameStateSize(&config));
+    printf("bot play, swept collision, %.0f simulated seconds per rate:\n", simulatedSeconds);
+    printf("%6s %14s %10s\n", "Hz", "us/sim second", "games");
+    for(int rate = 0;
+        rate < rateCount;
+        rate++)
+    {
+        GameState *gs = initializeGame(&arena, &transient, 7, &config);
+        Assert(gs);
+        double dt = 1.0 / rates[rate];
+        long long tickCount = (long long)(simulatedSeconds * rates[rate]);
+        int games = 1;
+        double start = linuxGetSeconds();
+        for(long long tick = 0;
+            tick < tickCount;
+            tick++)
+        {
+            GameInput input = linuxBotInputAt(tick * dt, dt);
+            GameUpdate(gs, &input, (float)dt);
+            if(gs->gameOver)
+            {
+                initializeGameState(gs, gs->transient, randomNext(&gs->random));
+                games++;
+            }
+        }
+        double seconds = linuxGetSeconds() - start;
+        printf("%6d %14.2f %10d\n", rates[rate], seconds * 1e6 / simulatedSeconds, games);
+    }
+    
+    linuxFreeArena(&transient);
+    linuxFreeArena(&arena);
+}
+
+// The resolve check's two large asteroids and bullet, returns where the one
+// that should be left starts
+static float
+linuxResolveSetup(GameState *gs, bool wrap)
+{
+    gs->asteroidSpawnInterval = 1e9f;
+    
+    // First is the one that should be left, second the one to go
+    float firstX = wrap ? 20.0f : 300.0f;
+    float secondX = wrap ? screenWidth - 4.0f : 316.0f;
+    float bulletX = wrap ? 1.0f : 312.0f;
+    AsteroidPool *asteroids = &gs->asteroids;
+    float asteroidX[2] = { firstX, secondX };
+    for(int k = 0;
+        k < 2;
+        k++)
+    {
+        int a = addAsteroid(asteroids, ASTEROID_LARGE);
+        asteroids->x[a] = asteroids->prevX[a] = asteroidX[k];
+        asteroids->y[a] = asteroids->prevY[a] = 300.0f;
+        asteroids->vx[a] = 10.0f;
+        asteroids->vy[a] = 0.0f;
+        asteroids->radius[a] = 30.0f;
+    }
+    
+    int b = allocateBullet(&gs->bullets);
+    Bullet *bullet = gs->bullets.bullet + b;
+    bullet->pos = bullet->prevPos = { bulletX, 300.0f };
+    bullet->velocity = { 0.0f, -gs->bulletSpeed };
+    bullet->timeLeft = gs->bulletLifetime;
+    return(firstX);
+}
+
+// NOTE(trist007): resolve check. One bullet sits over two overlapping large
+// asteroids, nearer to the second one. In the wrapping world the second one
+// is only nearer the short way round, across the seam. After a tick exactly
+// that one has to be gone. The two smalls it split into overlap the bullet
+// too, but it was used up on the large one, so both have to be there. Then
+// a few more ticks to show nothing else happens. The batch gets the bounded
+// setup too.
+static void
+linuxRunResolve(void)
+{
+    const char *broadphaseNames[] = { "brute", "grid", "sweep" };
+    
+    GameConfig config = defaultGameConfig();
+    config.bulletCapacity = 4;
+    config.largeAsteroidCapacity = 4;
+    config.smallAsteroidCapacity = 8;
+    Arena arena = linuxAllocArena(gameStateSize(&config));
+    Arena transient = linuxAllocArena(MEGABYTES(1));
+    
+    printf("one bullet over two overlapping large asteroids, per tick:\n");
+    printf("%10s %10s %9s %8s %8s %8s %8s %8s\n", "broadphase", "collision", "world", "bullets", "large", "small",
+           "kept", "check");
+    int failed = 0;
+    for(int broadphase = 0;
+        broadphase < 3;
+        broadphase++)
+    {
+        for(int swept = 0;
+            swept < 2;
+            swept++)
+        {
+            for(int wrap = 0;
+                wrap < 2;
+                wrap++)
+            {
+                config.broadphase = broadphase;
+                config.sweptCollision = swept;
+                config.wrapWorld = wrap;
+                GameState *gs = initializeGame(&arena, &transient, 20, &config);
+                Assert(gs);
+                float firstX = linuxResolveSetup(gs, wrap);
+                AsteroidPool *asteroids = &gs->asteroids;
+                
+                GameInput input = {};
+                bool same = true;
+                for(int tick = 0;
+                    tick < 4;
+                    tick++)
+                {
+                    GameUpdate(gs, &input, SIM_DT);
+                    same = same && !gs->gameOver && gs->bullets.freeCount == gs->bullets.capacity &&
+                           asteroids->classStats[ASTEROID_LARGE].live == 1 &&
+                           asteroids->classStats[ASTEROID_SMALL].live == 2;
+                }
+                
+                // Whichever large is left has to be the first one
+                bool kept = false;
+                for(int i = 0;
+                    i < asteroids->count;
+                    i++)
+                {
+                    if(asteroids->sizeClass[i] == ASTEROID_LARGE) kept = fabsf(asteroids->x[i] - firstX) < 1.0f;
+                }
+                same = same && kept;
+                failed += !same;
+                
+                printf("%10s %10s %9s %8d %8d %8d %8s %8s\n", broadphaseNames[broadphase], swept ? "swept" : "discrete",
+                       wrap ? "wrapping" : "bounded", gs->bullets.capacity - gs->bullets.freeCount,
+                       asteroids->classStats[ASTEROID_LARGE].live, asteroids->classStats[ASTEROID_SMALL].live,
+                       kept ? "nearest" : "WRONG", same ? "ok" : "WRONG");
+            }
+        }
+    }
+    
+    // The batch has to come out the same as the bounded GameUpdate games
+    {
+        Arena batchArena = linuxAllocArena(MEGABYTES(16));
+        GameBatch *batch = initializeGameBatch(&batchArena, 1, 20);
+        Assert(batch);
+        batch->rules.asteroidSpawnInterval = 1e9f;
+        int lanes = batch->laneCount;
+        
+        BatchAsteroids *large = &batch->largeAsteroids;
+        BatchAsteroids *small = &batch->smallAsteroids;
+        float asteroidX[2] = { 300.0f, 316.0f };
+        for(int k = 0;
+            k < 2;
+            k++)
+        {
+            int a = k * lanes;
+            large->x[a] = asteroidX[k];
+            large->y[a] = 300.0f;
+            large->vx[a] = 10.0f;
+            large->vy[a] = 0.0f;
+            large->size[a] = 30.0f;
+            large->active[a] = 1;
+        }
+        
+        BatchBullets *bullets = &batch->bullets;
+        bullets->x[0] = 312.0f;
+        bullets->y[0] = 300.0f;
+        bullets->vx[0] = 0.0f;
+        bullets->vy[0] = -batch->rules.bulletSpeed;
+        bullets->active[0] = 1;
+        
+        GameInput input = {};
+        bool same = true;
+        int liveBullets = 0;
+        int liveLarge = 0;
+        int liveSmall = 0;
+        bool kept = false;
+        for(int tick = 0;
+            tick < 4;
+            tick++)
+        {
+            GameBatchUpdate(batch, &input, SIM_DT);
+            
+            liveBullets = 0;
+            liveLarge = 0;
+            liveSmall = 0;
+            for(int slot = 0;
+                slot < bullets->slotCount;
+                slot++)
+            {
+                liveBullets += bullets->active[slot * lanes];
+            }
+            for(int slot = 0;
+                slot < large->slotCount;
+                slot++)
+            {
+                int a = slot * lanes;
+                liveLarge += large->active[a];
+                if(large->active[a]) kept = fabsf(large->x[a] - (asteroidX[0] + 10.0f * SIM_DT * (tick + 1))) < 1.0f;
+            }
+            for(int slot = 0;
+                slot < small->slotCount;
+                slot++)
+            {
+                liveSmall += small->active[slot * lanes];
+            }
+            same = same && !batch->gamesFinished && liveBullets == 0 && liveLarge == 1 && liveSmall == 2;
+        }
+        same = same && kept;
+        failed += !same;
+        
+        printf("%10s %10s %9s %8d %8d %8d %8s %8s\n", "batch", "discrete", "bounded", liveBullets, liveLarge, liveSmall,
+               kept ? "nearest" : "WRONG", same ? "ok" : "WRONG");
+        linuxFreeArena(&batchArena);
+    }
+    
+    // Scratch that only fits the hit lists, then only the mask: the events
+    // or the list don't fit with any broadphase, the tick has to drop its
+    // hits and the next one apply them
+    for(int full = 0;
+        full < 2;
+        full++)
+    {
+        config.broadphase = BROADPHASE_GRID;
+        config.sweptCollision = false;
+        config.wrapWorld = false;
+        GameState *gs = initializeGame(&arena, &transient, 20, &config);
+        Assert(gs);
+        linuxResolveSetup(gs, false);
+        
+        // The mask and the hit list, each cache line aligned
+        int capacity = gs->asteroids.capacity;
+        size_t room = 64 * ((MASK_WORDS(capacity) * 8 + 63) / 64);
+        if(!full) room += 64 * ((capacity * WRAP_MAX_IMAGES * sizeof(int) + 63) / 64);
+        transient.failedAllocs = 0;
+        void *filler = arena_alloc(&transient, transient.size - transient.used - room);
+        Assert(filler);
+        
+        GameInput input = {};
+        GameUpdate(gs, &input, SIM_DT);
+        AsteroidPool *asteroids = &gs->asteroids;
+        bool dropped = gs->bullets.freeCount == gs->bullets.capacity - 1 &&
+                       asteroids->classStats[ASTEROID_LARGE].live == 2 && transient.failedAllocs > 0;
+        size_t failedAllocs = transient.failedAllocs;
+        
+        GameUpdate(gs, &input, SIM_DT);
+        bool applied = gs->bullets.freeCount == gs->bullets.capacity &&
+                       asteroids->classStats[ASTEROID_LARGE].live == 1 &&
+                       asteroids->classStats[ASTEROID_SMALL].live == 2;
+        failed += !(dropped && applied);
+        printf("%-13s %s, %llu failed allocs, then %s %8s\n", full ? "mask only:" : "full scratch:",
+               dropped ? "hits dropped" : "WRONG", (unsigned long long)failedAllocs, applied ? "applied" : "WRONG",
+               (dropped && applied) ? "ok" : "WRONG");
+    }
+    printf("resolve:    %s\n", failed ? "WRONG" : "one asteroid per bullet, the nearest, splits wait a tick");
+    
+    linuxFreeArena(&transient);
+    linuxFreeArena(&arena);
+}
+
+// Swarm games with each broadphase from the same seed. Pair tests are the
+// circle tests done, the games have to come out byte for byte the same.
+// speedMultiplier scales the swarm's asteroid speeds, far enough up and a
+// swept candidate circle in a wrapping world is more than half of it across.
+static void
+linuxRunBroadphase(int bulletCount, int tickCount, bool swept, bool wrap, float speedMultiplier)
+{
+    int asteroidCounts[] = { 1000, 3000, 10000, 30000, 100000 };
+    int broadphaseCount = 3;
+    
+    printf("%d bullets, %d ticks per run, %s collision%s, asteroids at %.1fx speed, per tick:\n", bulletCount,
+           tickCount, swept ? "swept" : "discrete", wrap ? " in a wrapping world" : "", speedMultiplier);
+    printf("%9s %12s %12s %12s %10s %10s %10s %12s %8s\n", "asteroids", "brute pairs", "grid pairs",
+           "sweep pairs", "brute ms", "grid ms", "sweep ms", "sort shifts", "check");
+    for(int n = 0;
+        n < (int)(sizeof(asteroidCounts) / sizeof(asteroidCounts[0]));
+        n++)
+    {
+        GameConfig config = defaultGameConfig();
+        config.bulletCapacity = bulletCount;
+        config.largeAsteroidCapacity = asteroidCounts[n];
+        config.smallAsteroidCapacity = asteroidCounts[n] / 4;
+        config.sweptCollision = swept;
+        config.wrapWorld = wrap;
+        
+        // Same arena for both so the pool pointers inside match too
+        Arena arena = linuxAllocArena(gameStateSize(&config));
+        Arena transient = linuxAllocArena(GIGABYTES(1));
+        
+        double seconds[3];
+        long long pairTests[3];
+        long long sortShifts = 0;
+        unsigned char *endState[3];
+        size_t endUsed[3];
+        for(int broadphase = 0;
+            broadphase < broadphaseCount;
+            broadphase++)
+        {
+            config.broadphase = broadphase;
+            GameState *gs = initializeGame(&arena, &transient, 21, &config);
+            Assert(gs);
+            
+            GameTimings timings = {};
+            gs->timings = &timings;
+            RandomSeries series = seedRandomSeries(21);
+            
+            seconds[broadphase] = 0;
+            for(int tick = 0;
+                tick < tickCount;
+                tick++)
+            {
+                int first = gs->asteroids.count;
+                linuxFillSwarm(gs, &series);
+                for(int i = first;
+                    i < gs->asteroids.count;
+                    i++)
+                {
+                    gs->asteroids.vx[i] *= speedMultiplier;
+                    gs->asteroids.vy[i] *= speedMultiplier;
+                }
+                
+                GameInput input = linuxBotInput(tick);
+                double start = linuxGetSeconds();
+                GameUpdate(gs, &input, SIM_DT);
+                seconds[broadphase] += linuxGetSeconds() - start;
+                gs->gameOver = false;
+            }
+            pairTests[broadphase] = timings.pairTests;
+            if(broadphase == BROADPHASE_SWEEP) sortShifts = timings.sortShifts;
+            
+            // The kept sweep order is the only state the broadphases don't share
+            gs->config.broadphase = 0;
+            memset(gs->asteroids.sweepOrder, 0, ASTEROID_POOL_SLOTS(gs->asteroids.capacity) * sizeof(AsteroidHandle));
+            gs->asteroids.sweepCount = 0;
+            endUsed[broadphase] = arena.used;
+            endState[broadphase] = (unsigned char *)malloc(arena.used);
+            memcpy(endState[broadphase], arena.base, arena.used);
+        }
+        
+        bool same = true;
+        for(int broadphase = 1;
+            broadphase < broadphaseCount;
+            broadphase++)
+        {
+            same = same && endUsed[0] == endUsed[broadphase] &&
+                   memcmp(endState[0], endState[broadphase], endUsed[0]) == 0;
+        }
+        printf("%9d %12lld %12lld %12lld %10.3f %10.3f %10.3f %12lld %8s\n", asteroidCounts[n],
+               pairTests[BROADPHASE_BRUTE_FORCE] / tickCount, pairTests[BROADPHASE_GRID] / tickCount,
+               pairTests[BROADPHASE_SWEEP] / tickCount, seconds[BROADPHASE_BRUTE_FORCE] * 1000.0 / tickCount,
+               seconds[BROADPHASE_GRID] * 1000.0 / tickCount, seconds[BROADPHASE_SWEEP] * 1000.0 / tickCount,
+               sortShifts / tickCount, same ? "ok" : "DIVERGED");
+        
+        for(int broadphase = 0;
+            broadphase < broadphaseCount;
+            broadphase++)
+        {
+            free(endState[broadphase]);
+        }
+        linuxFreeArena(&transient);
+        linuxFreeArena(&arena);
+    }
+}
+
+// The headless backend: walks the list like a real one would and counts
+// what it finds and what a GPU backend would send for it, returns the bytes
+// it walked
+static size_t
+linuxCountRenderCommands(RenderCommands *commands, int *typeCount, int *instanceCount, RenderDrawStats *draws)
+{
+    size_t bytes = 0;
+    for(RenderCommandHeader *header = firstRenderCommand(commands);
+        header;
+        header = nextRenderCommand(commands, header))
+    {
+        typeCount[header->type]++;
+        if(header->type == RENDER_CIRCLE_INSTANCES) *instanceCount += ((RenderCircleInstances *)(header + 1))->count;
+        countRenderDraw(draws, header);
+        bytes += header->size;
+    }
+    return(bytes);
+}
+
+// Swarm games drawn into render commands every tick, the way the win32
+// layer draws a frame, at growing asteroid counts. Capture is copying the
+// RenderState out, build is GameRender, walk is the counting backend
+// reading the list back. Draws and vertices are what the raylib backend
+// sends, the asteroids as instance batches.
+static void
+linuxRunRender(int asteroidCount, int frameCount)
+{
+    const char *typeNames[RENDER_COMMAND_TYPE_COUNT] = { "clear", "circle", "triangle", "line", "text", "batches" };
+    int stepCount = 4;
+    
+    printf("%d frames per step, per frame:\n", frameCount);
+    printf("%9s", "asteroids");
+    for(int type = 0;
+        type < RENDER_COMMAND_TYPE_COUNT;
+        type++)
+    {
+        printf(" %9s", typeNames[type]);
+    }
+    printf(" %9s %7s %9s %10s %10s %10s %10s %8s\n", "instances", "draws", "vertices", "KB", "capture us", "build us",
+           "walk us", "check");
+    
+    for(int step = stepCount - 1;
+        step >= 0;
+        step--)
+    {
+        GameConfig config = defaultGameConfig();
+        config.broadphase = BROADPHASE_GRID;
+        config.bulletCapacity = 1000 >> step;
+        config.largeAsteroidCapacity = asteroidCount >> step;
+        config.smallAsteroidCapacity = (asteroidCount >> step) / 4;
+        
+        Arena arena = linuxAllocArena(gameStateSize(&config));
+        Arena transient = linuxAllocArena(GIGABYTES(1));
+        Arena renderArena = linuxAllocArena(MEGABYTES(256));
+        GameState *gs = initializeGame(&arena, &transient, 9, &config);
+        Assert(gs);
+        RandomSeries series = seedRandomSeries(9);
+        RenderState state;
+        bool pushed = pushRenderState(&renderArena, &state, &config);
+        Assert(pushed);
+        
+        long long typeTotal[RENDER_COMMAND_TYPE_COUNT] = {};
+        long long instanceTotal = 0;
+        RenderDrawStats drawTotal = {};
+        size_t bytes = 0;
+        double captureSeconds = 0;
+        double buildSeconds = 0;
+        double walkSeconds = 0;
+        bool same = true;
+        for(int frame = 0;
+            frame < frameCount;
+            frame++)
+        {
+            linuxFillSwarm(gs, &series);
+            GameInput input = linuxBotInput(frame);
+            GameUpdate(gs, &input, SIM_DT);
+            gs->gameOver = (frame % 2) == 0;
+            
+            TemporaryMemory commandMemory = beginTemporaryMemory(&renderArena);
+            RenderCommands commands;
+            double start = linuxGetSeconds();
+            captureRenderState(gs, &state);
+            double captured = linuxGetSeconds();
+            beginRenderCommands(&commands, &renderArena, screenWidth, screenHeight);
+            GameRender(&state, &commands, 0.5f);
+            double built = linuxGetSeconds();
+            
+            int walked[RENDER_COMMAND_TYPE_COUNT] = {};
+            int walkedInstances = 0;
+            size_t walkedBytes = linuxCountRenderCommands(&commands, walked, &walkedInstances, &drawTotal);
+            walkSeconds += linuxGetSeconds() - built;
+            buildSeconds += built - captured;
+            captureSeconds += captured - start;
+            
+            same = same && walkedBytes == commands.used && commands.dropped == 0 &&
+                   walkedInstances == commands.instanceCount;
+            instanceTotal += walkedInstances;
+            for(int type = 0;
+                type < RENDER_COMMAND_TYPE_COUNT;
+                type++)
+            {
+                same = same && walked[type] == commands.typeCount[type];
+                typeTotal[type] += walked[type];
+            }
+            bytes += walkedBytes;
+            endTemporaryMemory(commandMemory);
+        }
+        gs->gameOver = false;
+        
+        printf("%9d", config.largeAsteroidCapacity);
+        for(int type = 0;
+            type < RENDER_COMMAND_TYPE_COUNT;
+            type++)
+        {
+            printf(" %9.1f", (double)typeTotal[type] / frameCount);
+        }
+        printf(" %9.1f %7.1f %9.0f %10.1f %10.1f %10.1f %10.1f %8s\n", (double)instanceTotal / frameCount,
+               (double)drawTotal.drawCalls / frameCount, (double)drawTotal.vertices / frameCount,
+               bytes / 1024.0 / frameCount, captureSeconds * 1e6 / frameCount, buildSeconds * 1e6 / frameCount,
+               walkSeconds * 1e6 / frameCount, same ? "ok" : "MISMATCH");
+        
+        linuxFreeArena(&renderArena);
+        linuxFreeArena(&transient);
+        linuxFreeArena(&arena);
+    }
+}
+
+// A point on the wrapping screen, half the time within a few pixels of an
+// edge so the seams and corners get plenty of traffic. Whole pixels keep
+// every distance exact.
+static Vector2
+linuxSeamPoint(RandomSeries *series)
+{
+    Vector2 result;
+    if(randomRange(series, 0, 1))
+    {
+        result.x = (float)randomRange(series, 0, screenWidth - 1);
+        result.y = (float)randomRange(series, 0, screenHeight - 1);
+    }
+    else
+    {
+        int x = randomRange(series, -6, 6);
+        int y = randomRange(series, -6, 6);
+        result.x = (float)((x < 0) ? screenWidth + x : x);
+        result.y = (float)((y < 0) ? screenHeight + y : y);
+        if(randomRange(series, 0, 1)) result.x = (float)randomRange(series, 0, screenWidth - 1);
+        else if(randomRange(series, 0, 1)) result.y = (float)randomRange(series, 0, screenHeight - 1);
+    }
+    return(result);
+}
+
+// NOTE(trist007): two parts. The seam check freezes a wrapping world of
+// pebbles and bullets on whole pixels, runs one tick with each broadphase,
+// discrete and swept, and checks the asteroids that went are exactly the
+// ones the bullets picked, each the nearest in reach by minimum image
+// distance, worked out here the slow way. Then swarm games with and without wrapping: churn is how
+// many asteroids a tick despawns off screen (and gets topped back up) or
+// carries across a seam.
+static void
+linuxRunWrap(int asteroidCount, int bulletCount, int tickCount)
+{
+    const char *broadphaseNames[] = { "brute force", "grid", "sweep" };
+    
+    printf("seam check, %d pebbles, %d bullets, half of them near an edge:\n", asteroidCount, bulletCount);
+    printf("%12s %9s %10s %10s %10s %8s\n", "broadphase", "collision", "expected", "removed", "wrong", "check");
+    for(int swept = 0;
+        swept < 2;
+        swept++)
+    {
+        for(int broadphase = 0;
+            broadphase < 3;
+            broadphase++)
+        {
+            GameConfig config = defaultGameConfig();
+            config.broadphase = broadphase;
+            config.sweptCollision = (swept != 0);
+            config.wrapWorld = true;
+            config.bulletCapacity = bulletCount;
+            config.smallAsteroidCapacity = asteroidCount;
+            
+            Arena arena = linuxAllocArena(gameStateSize(&config));
+            Arena transient = linuxAllocArena(GIGABYTES(1));
+            GameState *gs = initializeGame(&arena, &transient, 5, &config);
+            Assert(gs);
+            RandomSeries series = seedRandomSeries(5);
+            
+            AsteroidPool *asteroids = &gs->asteroids;
+            AsteroidHandle *handle = (AsteroidHandle *)malloc(asteroidCount * sizeof(AsteroidHandle));
+            bool *expected = (bool *)malloc(asteroidCount * sizeof(bool));
+            int placed = 0;
+            while(placed < asteroidCount)
+            {
+                int i = addAsteroid(asteroids, ASTEROID_SMALL);
+                if(i < 0) break;
+                
+                Vector2 pos = linuxSeamPoint(&series);
+                asteroids->x[i] = asteroids->prevX[i] = pos.x;
+                asteroids->y[i] = asteroids->prevY[i] = pos.y;
+                asteroids->vx[i] = asteroids->vy[i] = 0;
+                asteroids->radius[i] = (float)randomRange(&series, 2, 4);
+                handle[placed++] = getAsteroidHandle(asteroids, i);
+            }
+            
+            BulletPool *bullets = &gs->bullets;
+            while(bullets->freeCount > 0)
+            {
+                Bullet *bullet = bullets->bullet + allocateBullet(bullets);
+                bullet->pos = bullet->prevPos = linuxSeamPoint(&series);
+                bullet->velocity = { 0, 0 };
+                bullet->timeLeft = gs->bulletLifetime;
+            }
+            
+            // Out of the way and standing still, nothing spawns this tick
+            gs->ship.pos = gs->ship.prevPos = { screenWidth / 2.0f, screenHeight / 2.0f };
+            gs->ship.velocity = { 0, 0 };
+            gs->asteroidSpawnTimer = 0;
+            
+            // Bullets in slot order, each taking the nearest pebble still
+            // there, the lower handle id on a tie
+            for(int k = 0;
+                k < placed;
+                k++)
+            {
+                expected[k] = false;
+            }
+            int expectedCount = 0;
+            for(int i = 0;
+                i < bullets->capacity;
+                i++)
+            {
+                int nearest = -1;
+                float nearestDistance = 0;
+                for(int k = 0;
+                    k < placed;
+                    k++)
+                {
+                    if(expected[k]) continue;
+                    
+                    int j = lookupAsteroid(asteroids, handle[k]);
+                    float dx = fabsf(bullets->bullet[i].pos.x - asteroids->x[j]);
+                    float dy = fabsf(bullets->bullet[i].pos.y - asteroids->y[j]);
+                    if(dx > screenWidth / 2.0f) dx = screenWidth - dx;
+                    if(dy > screenHeight / 2.0f) dy = screenHeight - dy;
+                    float reach = asteroids->radius[j] + gs->bulletRadius;
+                    float distance = dx * dx + dy * dy;
+                    if(distance < reach * reach &&
+                       (nearest < 0 || distance < nearestDistance ||
+                        (distance == nearestDistance && handle[k].id < handle[nearest].id)))
+                    {
+                        nearest = k;
+                        nearestDistance = distance;
+                    }
+                }
+                if(nearest >= 0)
+                {
+                    expected[nearest] = true;
+                    expectedCount++;
+                }
+            }
+            
+            GameInput input = {};
+            GameUpdate(gs, &input, SIM_DT);
+            
+            int removed = 0;
+            int wrong = 0;
+            for(int k = 0;
+                k < placed;
+                k++)
+            {
+                bool gone = lookupAsteroid(asteroids, handle[k]) < 0;
+                removed += gone;
+                wrong += (gone != expected[k]);
+            }
+            printf("%12s %9s %10d %10d %10d %8s\n", broadphaseNames[broadphase], swept ? "swept" : "discrete",
+                   expectedCount, removed, wrong, wrong ? "WRONG" : "ok");
+            
+            free(expected);
+            free(handle);
+            linuxFreeArena(&transient);
+            linuxFreeArena(&arena);
+        }
+    }
+    
+    printf("\n%d asteroids, %d bullets, grid broadphase, %d ticks, per tick:\n", asteroidCount, bulletCount, tickCount);
+    printf("%9s %10s %12s %10s\n", "world", "churn", "pair tests", "us");
+    for(int wrap = 0;
+        wrap < 2;
+        wrap++)
+    {
+        GameConfig config = defaultGameConfig();
+        config.broadphase = BROADPHASE_GRID;
+        config.wrapWorld = (wrap != 0);
+        config.bulletCapacity = bulletCount;
+        config.largeAsteroidCapacity = asteroidCount;
+        config.smallAsteroidCapacity = asteroidCount / 4;
+        
+        Arena arena = linuxAllocArena(gameStateSize(&config));
+        Arena transient = linuxAllocArena(GIGABYTES(1));
+        GameState *gs = initializeGame(&arena, &transient, 9, &config);
+        Assert(gs);
+        
+        GameTimings timings = {};
+        gs->timings = &timings;
+        gs->bulletRadius = 1.0f;
+        RandomSeries series = seedRandomSeries(9);
+        
+        long long churn = 0;
+        double seconds = 0;
+        for(int tick = 0;
+            tick < tickCount;
+            tick++)
+        {
+            linuxFillSwarm(gs, &series);
+            
+            // Where this tick's move takes them: across a seam, or far
+            // enough off screen to be despawned and topped back up
+            AsteroidPool *asteroids = &gs->asteroids;
+            for(int i = 0;
+                i < asteroids->count;
+                i++)
+            {
+                float x = asteroids->x[i] + asteroids->vx[i] * SIM_DT;
+                float y = asteroids->y[i] + asteroids->vy[i] * SIM_DT;
+                float margin = wrap ? 0 : asteroids->classMargin[asteroids->sizeClass[i]];
+                churn += (x < -margin) | (x >= screenWidth + margin) | (y < -margin) | (y >= screenHeight + margin);
+            }
+            
+            GameInput input = linuxBotInput(tick);
+            double start = linuxGetSeconds();
+            GameUpdate(gs, &input, SIM_DT);
+            seconds += linuxGetSeconds() - start;
+            gs->gameOver = false;
+        }
+        printf("%9s %10.2f %12lld %10.1f\n", wrap ? "wrapping" : "despawn", (double)churn / tickCount,
+               timings.pairTests / tickCount, seconds * 1e6 / tickCount);
+        
+        linuxFreeArena(&transient);
+        linuxFreeArena(&arena);
+    }
+}
+
+// NOTE(trist007): stress run for the arena sized pools. Ramps up to
+// asteroidCount asteroids and bulletCount bullets, doubling both every step,
+// and times each GameUpdate phase with the TSC blocks against a 60 Hz frame.
+// The pools are topped back up before every tick and the ship can't die, so
+// the counts hold for the whole step.
+static void
+linuxRunSwarm(int asteroidCount, int bulletCount, int tickCount, int broadphase)
+{
+    const char *phaseNames[TIMED_BLOCK_COUNT] = { "ship", "bullets", "spawn", "move", "despawn", "bullet hit", "ship hit" };
+    double budgetMs = 1000.0 / 60.0;
+    int stepCount = 6;
+    
+    const char *broadphaseNames[] = { "brute force", "grid", "sweep" };
+    
+    printf("%d asteroids, %d bullets, %s broadphase, %d ticks per step, %.1f ms budget, ms per tick:\n",
+           asteroidCount, bulletCount, broadphaseNames[broadphase], tickCount, budgetMs);
+    printf("%9s %8s", "asteroids", "bullets");
+    for(int phase = 0;
+        phase < TIMED_BLOCK_COUNT;
+        phase++)
+    {
+        printf(" %10s", phaseNames[phase]);
+    }
+    printf(" %10s %10s\n", "frame", "worst");
+    
+    int overPhase = -1;
+    int overAsteroids = 0;
+    int overBullets = 0;
+    double overMs = 0;
+    for(int step = stepCount - 1;
+        step >= 0;
+        step--)
+    {
+        GameConfig config = defaultGameConfig();
+        config.broadphase = broadphase;
+        config.bulletCapacity = bulletCount >> step;
+        config.largeAsteroidCapacity = asteroidCount >> step;
+        config.smallAsteroidCapacity = (asteroidCount >> step) / 4;
+        
+        Arena arena = linuxAllocArena(gameStateSize(&config));
+        Arena transient = linuxAllocArena(GIGABYTES(1));
+        GameState *gs = initializeGame(&arena, &transient, 9, &config);
+        Assert(gs);
+        
+        GameTimings timings = {};
+        gs->timings = &timings;
+        gs->bulletRadius = 1.0f;
+        RandomSeries series = seedRandomSeries(9);
+        
+        unsigned long long phaseCycles[TIMED_BLOCK_COUNT] = {};
+        unsigned long long frameCycles = 0;
+        unsigned long long worstCycles = 0;
+        double frameSeconds = 0;
+        long long liveAsteroids = 0;
+        long long liveBullets = 0;
+        for(int tick = 0;
+            tick < tickCount;
+            tick++)
+        {
+            linuxFillSwarm(gs, &series);
+            liveAsteroids += gs->asteroids.count;
+            liveBullets += gs->bullets.stats.live;
+            
+            GameInput input = linuxBotInput(tick);
+            timings = {};
+            double start = linuxGetSeconds();
+            unsigned long long startCycles = __rdtsc();
+            GameUpdate(gs, &input, SIM_DT);
+            unsigned long long cycles = __rdtsc() - startCycles;
+            frameSeconds += linuxGetSeconds() - start;
+            gs->gameOver = false;
+            
+            frameCycles += cycles;
+            if(cycles > worstCycles) worstCycles = cycles;
+            for(int phase = 0;
+                phase < TIMED_BLOCK_COUNT;
+                phase++)
+            {
+                phaseCycles[phase] += timings.cycles[phase];
+            }
+        }
+        
+        // The TSC ticks at a fixed rate, the wall clock over the same ticks
+        // converts it
+        double msPerCycle = frameSeconds * 1000.0 / frameCycles;
+        printf("%9lld %8lld", liveAsteroids / tickCount, liveBullets / tickCount);
+        for(int phase = 0;
+            phase < TIMED_BLOCK_COUNT;
+            phase++)
+        {
+            double ms = phaseCycles[phase] * msPerCycle / tickCount;
+            printf(" %9.3f%c", ms, ms > budgetMs ? '!' : ' ');
+            if(ms > budgetMs && (overPhase < 0 || (overAsteroids == config.largeAsteroidCapacity && ms > overMs)))
+            {
+                overPhase = phase;
+                overAsteroids = config.largeAsteroidCapacity;
+                overBullets = config.bulletCapacity;
+                overMs = ms;
+            }
+        }
+        printf(" %9.3f%c %9.3f%c\n", frameSeconds * 1000.0 / tickCount, frameSeconds * 1000.0 / tickCount > budgetMs ? '!' : ' ',
+               worstCycles * msPerCycle, worstCycles * msPerCycle > budgetMs ? '!' : ' ');
+        
+        linuxFreeArena(&transient);
+        linuxFreeArena(&arena);
+    }
+    
+    if(overPhase >= 0)
+    {
+        printf("first over budget: %s, %.1f ms per tick at %d asteroids and %d bullets\n",
+               phaseNames[overPhase], overMs, overAsteroids, overBullets);
+    }
+    else
+    {
+        printf("first over budget: none, every phase fits in %.1f ms\n", budgetMs);
+    }
+}
+
+#include "linux_raster.cpp"
+
+int
+main(int argc, char **argv)
+{
+    if(argc > 1 && strcmp(argv[1], "batch") == 0)
+    {
+        long long gameTicks = 1 << 22;
+        if(argc > 2) gameTicks = atoll(argv[2]);
+        linuxRunBatch(gameTicks);
+    }
+    else if(argc > 1 && strcmp(argv[1], "sessions") == 0)
+    {
+        int sessionCount = 4096;
+        long long ticks = 10 * SIM_HZ;
+        int maxWorkers = 0;
+        if(argc > 2) sessionCount = atoi(argv[2]);
+        if(argc > 3) ticks = atoll(argv[3]);
+        if(argc > 4) maxWorkers = atoi(argv[4]);
+        linuxRunSessions(sessionCount, ticks, maxWorkers);
+    }
+    else if(argc > 1 && strcmp(argv[1], "arena") == 0)
+    {
+        int gameCount = 16384;
+        long long ticks = 5 * SIM_HZ;
+        if(argc > 2) gameCount = atoi(argv[2]);
+        if(argc > 3) ticks = atoll(argv[3]);
+        linuxRunArena(gameCount, ticks);
+    }
+    else if(argc > 1 && strcmp(argv[1], "replay") == 0)
+    {
+        long long ticks = 30 * SIM_HZ;
+        int loops = 100;
+        if(argc > 2) ticks = atoll(argv[2]);
+        if(argc > 3) loops = atoi(argv[3]);
+        linuxRunReplay(ticks, loops);
+    }
+    else if(argc > 1 && strcmp(argv[1], "soa") == 0)
+    {
+        int count = 16384;
+        int ticks = 2000;
+        if(argc > 2) count = atoi(argv[2]);
+        if(argc > 3) ticks = atoi(argv[3]);
+        linuxRunSoA(count, ticks);
+    }
+    else if(argc > 1 && strcmp(argv[1], "handles") == 0)
+    {
+        int count = 4096;
+        int rounds = 2000;
+        if(argc > 2) count = atoi(argv[2]);
+        if(argc > 3) rounds = atoi(argv[3]);
+        linuxRunHandles(count, rounds);
+    }
+    else if(argc > 1 && strcmp(argv[1], "mask") == 0)
+    {
+        int capacity = 4096;
+        int ticks = 20000;
+        if(argc > 2) capacity = atoi(argv[2]);
+        if(argc > 3) ticks = atoi(argv[3]);
+        linuxRunMask(capacity, ticks);
+    }
+    else if(argc > 1 && strcmp(argv[1], "narrowphase") == 0)
+    {
+        int count = 4096;
+        int rounds = 200;
+        if(argc > 2) count = atoi(argv[2]);
+        if(argc > 3) rounds = atoi(argv[3]);
+        linuxRunNarrowphase(count, rounds);
+    }
+    else if(argc > 1 && strcmp(argv[1], "swarm") == 0)
+    {
+        int asteroidCount = 100000;
+        int bulletCount = 10000;
+        int ticks = 10;
+        int broadphase = BROADPHASE_GRID;
+        if(argc > 2) asteroidCount = atoi(argv[2]);
+        if(argc > 3) bulletCount = atoi(argv[3]);
+        if(argc > 4) ticks = atoi(argv[4]);
+        if(argc > 5 && strcmp(argv[5], "brute") == 0) broadphase = BROADPHASE_BRUTE_FORCE;
+        if(argc > 5 && strcmp(argv[5], "sweep") == 0) broadphase = BROADPHASE_SWEEP;
+        linuxRunSwarm(asteroidCount, bulletCount, ticks, broadphase);
+    }
+    else if(argc > 1 && strcmp(argv[1], "tunnel") == 0)
+    {
+        int trials = 5000;
+        float maxSpeedMultiplier = 4.0f;
+        if(argc > 2) trials = atoi(argv[2]);
+        if(argc > 3) maxSpeedMultiplier = (float)atof(argv[3]);
+        linuxRunTunnel(trials, maxSpeedMultiplier);
+    }
+    else if(argc > 1 && strcmp(argv[1], "resolve") == 0)
+    {
+        linuxRunResolve();
+    }
+    else if(argc > 1 && strcmp(argv[1], "broadphase") == 0)
+    {
+        int bulletCount = 1000;
+        int ticks = 20;
+        if(argc > 2) bulletCount = atoi(argv[2]);
+        if(argc > 3) ticks = atoi(argv[3]);
+        bool swept = false;
+        bool wrap = false;
+        float speedMultiplier = 1.0f;
+        for(int arg = 4;
+            arg < argc;
+            arg++)
+        {
+            if(strcmp(argv[arg], "swept") == 0) swept = true;
+            else if(strcmp(argv[arg], "wrap") == 0) wrap = true;
+            else speedMultiplier = (float)atof(argv[arg]);
+        }
+        linuxRunBroadphase(bulletCount, ticks, swept, wrap, speedMultiplier);
+    }
+    else if(argc > 1 && strcmp(argv[1], "render") == 0)
+    {
+        int asteroidCount = 80000;
+        int frames = 300;
+        if(argc > 2) asteroidCount = atoi(argv[2]);
+        if(argc > 3) frames = atoi(argv[3]);
+        linuxRunRender(asteroidCount, frames);
+    }
+    else if(argc > 1 && strcmp(argv[1], "raster") == 0)
+    {
+        int asteroidCount = 10000;
+        int frames = 200;
+        int workers = 0;
+        const char *golden = 0;
+        if(argc > 2) asteroidCount = atoi(argv[2]);
+        if(argc > 3) frames = atoi(argv[3]);
+        if(argc > 4) workers = atoi(argv[4]);
+        if(argc > 5) golden = argv[5];
+        linuxRunRaster(asteroidCount, frames, workers, golden);
+    }
+    else if(argc > 1 && strcmp(argv[1], "present") == 0)
+    {
+        int asteroidCount = 10000;
+        double seconds = 5.0;
+        if(argc > 2) asteroidCount = atoi(argv[2]);
+        if(argc > 3) seconds = atof(argv[3]);
+        linuxRunPresent(asteroidCount, seconds);
+    }
+    else if(argc > 1 && strcmp(argv[1], "wrap") == 0)
+    {
+        int asteroidCount = 20000;
+        int bulletCount = 1000;
+        int ticks = 600;
+        if(argc > 2) asteroidCount = atoi(argv[2]);
+        if(argc > 3) bulletCount = atoi(argv[3]);
+        if(argc > 4) ticks = atoi(argv[4]);
+        linuxRunWrap(asteroidCount, bulletCount, ticks);
+    }
+    else if(argc > 1 && strcmp(argv[1], "random") == 0)
+    {
+        int laneCount = 4096;
+        long long rounds = 20000;
+        if(argc > 2) laneCount = atoi(argv[2]);
+        if(argc > 3) rounds = atoll(argv[3]);
+        linuxRunRandom(laneCount, rounds);
+    }
+    else if(argc > 1 && strcmp(argv[1], "snapshot") == 0)
+    {
+        int gameCount = 2048;
+        long long saves = 2000;
+        int touched = 16;
+        if(argc > 2) gameCount = atoi(argv[2]);
+        if(argc > 3) saves = atoll(argv[3]);
+        if(argc > 4) touched = atoi(argv[4]);
+        linuxRunSnapshot(gameCount, saves, touched);
+    }
+    else
+    {
+        long long frameCount = 10000000;
+        if(argc > 1) frameCount = atoll(argv[1]);
+        linuxRunSingle(frameCount);
+    }
+    
+    return(0);
+}
@@ -0,0 +1,543 @@
+// Tile parallel software rendering for the headless runner.
+//
+// The calling thread and workerCount - 1 helpers share a frame's tiles
+// through one atomic counter, whoever is free takes the next tile. The
+// helpers park on a barrier between frames.
+
+#define RASTER_MAX_WORKERS 64
+
+typedef struct __attribute__((aligned(64)))
+{
+    struct LinuxRasterPool *pool;
+    pthread_t thread;
+    long long written;
+} LinuxRasterWorker;
+
+typedef struct LinuxRasterPool
+{
+    int workerCount;
+    LinuxRasterWorker workers[RASTER_MAX_WORKERS];
+    
+    RasterFrame *frame;
+    volatile int nextTile;
+    volatile bool quit;
+    
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+} LinuxRasterPool;
+
+static void
+linuxRasterTiles(LinuxRasterWorker *worker)
+{
+    LinuxRasterPool *pool = worker->pool;
+    for(;;)
+    {
+        int tile = __atomic_fetch_add(&pool->nextTile, 1, __ATOMIC_RELAXED);
+        if(tile >= pool->frame->tileCount) break;
+        worker->written += rasterizeTile(pool->frame, tile);
+    }
+}
+
+static void *
+linuxRasterWorkerProc(void *param)
+{
+    LinuxRasterWorker *worker = (LinuxRasterWorker *)param;
+    LinuxRasterPool *pool = worker->pool;
+    for(;;)
+    {
+        pthread_barrier_wait(&pool->start);
+        if(pool->quit) break;
+        linuxRasterTiles(worker);
+        pthread_barrier_wait(&pool->done);
+    }
+    return(0);
+}
+
+static void
+linuxStartRasterPool(LinuxRasterPool *pool, int workerCount)
+{
+    Assert(workerCount > 0 && workerCount <= RASTER_MAX_WORKERS);
+    pool->workerCount = workerCount;
+    pool->quit = false;
+    pthread_barrier_init(&pool->start, 0, workerCount);
+    pthread_barrier_init(&pool->done, 0, workerCount);
+    for(int w = 0;
+        w < workerCount;
+        w++)
+    {
+        pool->workers[w].pool = pool;
+        pool->workers[w].written = 0;
+        if(w > 0) pthread_create(&pool->workers[w].thread, 0, linuxRasterWorkerProc, pool->workers + w);
+    }
+}
+
+static void
+linuxStopRasterPool(LinuxRasterPool *pool)
+{
+    pool->quit = true;
+    pthread_barrier_wait(&pool->start);
+    for(int w = 1;
+        w < pool->workerCount;
+        w++)
+    {
+        pthread_join(pool->workers[w].thread, 0);
+    }
+    pthread_barrier_destroy(&pool->start);
+    pthread_barrier_destroy(&pool->done);
+}
+
+// Runs every tile of a binned frame, the calling thread pitching in. The
+// barriers order the tile writes before whatever reads the framebuffer next.
+static void
+linuxRasterizeFrame(LinuxRasterPool *pool, RasterFrame *frame)
+{
+    pool->frame = frame;
+    pool->nextTile = 0;
+    pthread_barrier_wait(&pool->start);
+    linuxRasterTiles(pool->workers);
+    pthread_barrier_wait(&pool->done);
+}
+
+// Binary PPM, the alpha gets dropped
+static bool
+linuxWritePPM(const char *path, Framebuffer *buffer)
+{
+    FILE *file = fopen(path, "wb");
+    if(!file) return(false);
+    
+    fprintf(file, "P6\n%d %d\n255\n", buffer->width, buffer->height);
+    unsigned char *rgb = (unsigned char *)malloc((size_t)buffer->width * 3);
+    for(int y = 0;
+        y < buffer->height;
+        y++)
+    {
+        unsigned char *row = buffer->pixels + (size_t)y * buffer->pitch;
+        for(int x = 0;
+            x < buffer->width;
+            x++)
+        {
+            rgb[x * 3 + 0] = row[x * 4 + 0];
+            rgb[x * 3 + 1] = row[x * 4 + 1];
+            rgb[x * 3 + 2] = row[x * 4 + 2];
+        }
+        fwrite(rgb, 1, (size_t)buffer->width * 3, file);
+    }
+    free(rgb);
+    return(fclose(file) == 0);
+}
+
+// Pixels whose RGB differs from the PPM at path, -1 when there is no such
+// file and -2 when it isn't a PPM of the same size
+static long long
+linuxComparePPM(const char *path, Framebuffer *buffer)
+{
+    FILE *file = fopen(path, "rb");
+    if(!file) return(-1);
+    
+    int width = 0;
+    int height = 0;
+    int maxValue = 0;
+    long long result = -2;
+    if(fscanf(file, "P6 %d %d %d", &width, &height, &maxValue) == 3 && fgetc(file) != EOF &&
+       width == buffer->width && height == buffer->height && maxValue == 255)
+    {
+        unsigned char *rgb = (unsigned char *)malloc((size_t)width * 3);
+        result = 0;
+        for(int y = 0;
+            y < height && result >= 0;
+            y++)
+        {
+            if(fread(rgb, 1, (size_t)width * 3, file) != (size_t)width * 3)
+            {
+                result = -2;
+                break;
+            }
+            unsigned char *row = buffer->pixels + (size_t)y * buffer->pitch;
+            for(int x = 0;
+                x < width;
+                x++)
+            {
+                result += (rgb[x * 3 + 0] != row[x * 4 + 0]) | (rgb[x * 3 + 1] != row[x * 4 + 1]) |
+                          (rgb[x * 3 + 2] != row[x * 4 + 2]);
+            }
+        }
+        free(rgb);
+    }
+    fclose(file);
+    return(result);
+}
+
+// NOTE(trist007): one swarm frame of asteroidCount pebbles with the game
+// over text on top, rasterised frameCount times with 1, 2, 4 ... workers.
+// Frame MP/s is screen pixels per second, written MP/s counts overdraw too.
+// Every worker count has to give the single threaded picture. With a path
+// the frame is checked against that golden PPM, or written there when it
+// doesn't exist yet.
+static void
+linuxRunRaster(int asteroidCount, int frameCount, int maxWorkers, const char *goldenPath)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if(maxWorkers <= 0) maxWorkers = (int)cores;
+    if(maxWorkers > RASTER_MAX_WORKERS) maxWorkers = RASTER_MAX_WORKERS;
+    
+    GameConfig config = defaultGameConfig();
+    config.broadphase = BROADPHASE_GRID;
+    config.bulletCapacity = 1000;
+    config.largeAsteroidCapacity = asteroidCount;
+    config.smallAsteroidCapacity = asteroidCount / 4;
+    
+    Arena arena = linuxAllocArena(gameStateSize(&config));
+    Arena transient = linuxAllocArena(GIGABYTES(1));
+    Arena renderArena = linuxAllocArena(MEGABYTES(256));
+    GameState *gs = initializeGame(&arena, &transient, 9, &config);
+    Assert(gs);
+    
+    RandomSeries series = seedRandomSeries(9);
+    for(int tick = 0;
+        tick < SIM_HZ;
+        tick++)
+    {
+        linuxFillSwarm(gs, &series);
+        GameInput input = linuxBotInput(tick);
+        GameUpdate(gs, &input, SIM_DT);
+        gs->gameOver = false;
+    }
+    gs->gameOver = true;
+    
+    Framebuffer reference;
+    Framebuffer target;
+    bool pushed = pushFramebuffer(&renderArena, &reference, screenWidth, screenHeight) &&
+                  pushFramebuffer(&renderArena, &target, screenWidth, screenHeight);
+    Assert(pushed);
+    
+    RenderState state;
+    RenderCommands commands;
+    pushed = pushRenderState(&renderArena, &state, &config);
+    Assert(pushed);
+    captureRenderState(gs, &state);
+    beginRenderCommands(&commands, &renderArena, screenWidth, screenHeight);
+    GameRender(&state, &commands, 0.5f);
+    
+    printf("%d asteroids, %dx%d, %d commands, %d frames per run, %ld cores online\n", gs->asteroids.count,
+           screenWidth, screenHeight, commands.count, frameCount, cores);
+    printf("%8s %10s %10s %12s %12s %8s\n", "workers", "bin ms", "frame ms", "frame MP/s", "written MP/s",
+           "check");
+    
+    double framePixels = (double)screenWidth * screenHeight;
+    for(int workerCount = 1;
+        ;
+        workerCount *= 2)
+    {
+        if(workerCount > maxWorkers) workerCount = maxWorkers;
+        
+        LinuxRasterPool *pool = (LinuxRasterPool *)malloc(sizeof(LinuxRasterPool));
+        linuxStartRasterPool(pool, workerCount);
+        
+        double binSeconds = 0;
+        double seconds = 0;
+        for(int frame = 0;
+            frame < frameCount;
+            frame++)
+        {
+            TemporaryMemory binMemory = beginTemporaryMemory(&renderArena);
+            RasterFrame rasterFrame;
+            double start = linuxGetSeconds();
+            bool binned = beginRasterFrame(&rasterFrame, &renderArena, &commands, &target);
+            Assert(binned);
+            double binEnd = linuxGetSeconds();
+            linuxRasterizeFrame(pool, &rasterFrame);
+            double end = linuxGetSeconds();
+            binSeconds += binEnd - start;
+            seconds += end - start;
+            endTemporaryMemory(binMemory);
+        }
+        
+        long long written = 0;
+        for(int w = 0;
+            w < workerCount;
+            w++)
+        {
+            written += pool->workers[w].written;
+        }
+        linuxStopRasterPool(pool);
+        free(pool);
+        
+        if(workerCount == 1) memcpy(reference.pixels, target.pixels, (size_t)target.pitch * target.height);
+        bool same = memcmp(reference.pixels, target.pixels, (size_t)target.pitch * target.height) == 0;
+        printf("%8d %10.3f %10.3f %12.1f %12.1f %8s\n", workerCount, binSeconds * 1000.0 / frameCount,
+               seconds * 1000.0 / frameCount, framePixels * frameCount / seconds / 1e6, written / seconds / 1e6,
+               same ? "ok" : "DIFFERS");
+        
+        if(workerCount == maxWorkers) break;
+    }
+    
+    if(goldenPath)
+    {
+        long long differ = linuxComparePPM(goldenPath, &reference);
+        if(differ == -1)
+        {
+            bool wrote = linuxWritePPM(goldenPath, &reference);
+            printf("golden:   %s %s\n", goldenPath, wrote ? "written" : "could not be written");
+        }
+        else if(differ == -2)
+        {
+            printf("golden:   %s DIFFERS (not a %dx%d PPM)\n", goldenPath, reference.width, reference.height);
+        }
+        else
+        {
+            printf("golden:   %s %s (%lld pixels differ)\n", goldenPath, differ ? "DIFFERS" : "matches", differ);
+        }
+    }
+    
+    linuxFreeArena(&renderArena);
+    linuxFreeArena(&transient);
+    linuxFreeArena(&arena);
+}
+
+// Shared by the present benchmark's sim thread and the render loop
+typedef struct
+{
+    GameState *gs;
+    RandomSeries series;
+    RenderStateBuffer *states;
+    long long ticks;
+    
+    // Written by the render loop, inputSequence goes up after every change
+    volatile int keys;
+    volatile long inputSequence;
+    volatile bool quit;
+} LinuxPresentSim;
+
+// One tick of a full swarm steered by keys, the ship can't die
+static void
+linuxPresentTick(LinuxPresentSim *sim, int keys)
+{
+    linuxFillSwarm(sim->gs, &sim->series);
+    GameInput input = {};
+    input.rotateRight = true;
+    input.thrust = keys != 0;
+    GameUpdate(sim->gs, &input, SIM_DT);
+    sim->gs->gameOver = false;
+    sim->ticks++;
+}
+
+static void
+linuxPresentPublish(LinuxPresentSim *sim, long sequence)
+{
+    RenderState *state = beginRenderStateWrite(sim->states);
+    captureRenderState(sim->gs, state);
+    state->tick = sim->ticks;
+    state->inputSequence = sequence;
+    state->publishedSeconds = linuxGetSeconds();
+    publishRenderState(sim->states);
+}
+
+static void *
+linuxPresentSimProc(void *param)
+{
+    LinuxPresentSim *sim = (LinuxPresentSim *)param;
+    double nextTick = linuxGetSeconds();
+    while(!__atomic_load_n(&sim->quit, __ATOMIC_RELAXED))
+    {
+        double now = linuxGetSeconds();
+        if(now < nextTick)
+        {
+            double wait = nextTick - now;
+            timespec sleep = { 0, (long)(wait * 1e9) };
+            nanosleep(&sleep, 0);
+            continue;
+        }
+        
+        // Don't spiral trying to catch up after a long stall
+        if(now - nextTick > 0.25) nextTick = now;
+        nextTick += SIM_DT;
+        
+        // Sequence first, whatever it counts is in the keys read after it
+        long sequence = __atomic_load_n(&sim->inputSequence, __ATOMIC_ACQUIRE);
+        linuxPresentTick(sim, __atomic_load_n(&sim->keys, __ATOMIC_RELAXED));
+        linuxPresentPublish(sim, sequence);
+    }
+    return(0);
+}
+
+static int
+linuxCompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return((x > y) - (x < y));
+}
+
+// Sorts values
+static double
+linuxPercentile(double *values, int count, double fraction)
+{
+    double result = 0;
+    if(count)
+    {
+        qsort(values, count, sizeof(double), linuxCompareDoubles);
+        int index = (int)(fraction * (count - 1) + 0.5);
+        result = values[index];
+    }
+    return(result);
+}
+
+#define PRESENT_MAX_FRAMES (1 << 20)
+
+// NOTE(trist007): what the render thread buys. The render loop stands in for
+// the window: it plays the keyboard, builds the frame and rasterises it on
+// one core, a frame counts as presented when the last tile is done. Single
+// runs the fixed step ticks in that loop like a one threaded platform does.
+// Threaded puts them on a sim thread that ticks at SIM_HZ real time and
+// hands the loop RenderStates through the triple buffer. Latency is from a
+// key change to the end of the first frame drawn from a tick that saw it.
+static void
+linuxRunPresent(int asteroidCount, double seconds)
+{
+    GameConfig config = defaultGameConfig();
+    config.broadphase = BROADPHASE_GRID;
+    config.bulletCapacity = 1000;
+    config.largeAsteroidCapacity = asteroidCount;
+    config.smallAsteroidCapacity = asteroidCount / 4;
+    
+    double *frameSeconds = (double *)malloc(PRESENT_MAX_FRAMES * sizeof(double));
+    double *latencySeconds = (double *)malloc(PRESENT_MAX_FRAMES * sizeof(double));
+    
+    printf("%d asteroids, %dx%d, %.1f s per run, %ld cores online\n", asteroidCount, screenWidth, screenHeight,
+           seconds, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%9s %8s %10s %10s %12s %10s %10s %10s\n", "mode", "frames", "frame ms", "p99 ms", "latency ms", "p99 ms",
+           "max ms", "ticks/s");
+    
+    for(int threaded = 0;
+        threaded < 2;
+        threaded++)
+    {
+        Arena arena = linuxAllocArena(gameStateSize(&config));
+        Arena transient = linuxAllocArena(GIGABYTES(1));
+        Arena renderArena = linuxAllocArena(MEGABYTES(256));
+        
+        LinuxPresentSim sim = {};
+        sim.gs = initializeGame(&arena, &transient, 9, &config);
+        sim.series = seedRandomSeries(9);
+        Assert(sim.gs);
+        
+        RenderStateBuffer states;
+        Framebuffer target;
+        bool pushed = pushRenderStateBuffer(&renderArena, &states, &config) &&
+                      pushFramebuffer(&renderArena, &target, screenWidth, screenHeight);
+        Assert(pushed);
+        sim.states = &states;
+        linuxPresentTick(&sim, 0);
+        linuxPresentPublish(&sim, 0);
+        
+        LinuxRasterPool *pool = (LinuxRasterPool *)malloc(sizeof(LinuxRasterPool));
+        linuxStartRasterPool(pool, 1);
+        
+        pthread_t simThread;
+        if(threaded) pthread_create(&simThread, 0, linuxPresentSimProc, &sim);
+        
+        int frameCount = 0;
+        int latencyCount = 0;
+        int keys = 0;
+        long sequence = 0;
+        long pendingSequence = 0;
+        double pendingSeconds = 0;
+        double accumulator = 0;
+        double start = linuxGetSeconds();
+        double lastFrameStart = start;
+        double lastFrameEnd = start;
+        while(lastFrameEnd - start < seconds && frameCount < PRESENT_MAX_FRAMES)
+        {
+            double frameStart = linuxGetSeconds();
+            
+            // A key that flips every 100 ms
+            int newKeys = fmod(frameStart - start, 0.2) < 0.1;
+            if(newKeys != keys)
+            {
+                keys = newKeys;
+                __atomic_store_n(&sim.keys, keys, __ATOMIC_RELAXED);
+                sequence = __atomic_add_fetch(&sim.inputSequence, 1, __ATOMIC_RELEASE);
+                if(!pendingSequence)
+                {
+                    pendingSequence = sequence;
+                    pendingSeconds = frameStart;
+                }
+            }
+            
+            float alpha;
+            bool fresh;
+            if(threaded)
+            {
+                RenderState *newest = acquireRenderState(&states, &fresh);
+                alpha = (float)((frameStart - newest->publishedSeconds) / SIM_DT);
+                if(alpha > 1.0f) alpha = 1.0f;
+            }
+            else
+            {
+                accumulator += frameStart - lastFrameStart;
+                if(accumulator > 0.25) accumulator = 0.25;
+                while(accumulator >= SIM_DT)
+                {
+                    linuxPresentTick(&sim, keys);
+                    accumulator -= SIM_DT;
+                }
+                
+                // Same capture the sim thread does, so both draw the same way
+                linuxPresentPublish(&sim, sequence);
+                alpha = (float)(accumulator / SIM_DT);
+            }
+            RenderState *state = acquireRenderState(&states, &fresh);
+            
+            TemporaryMemory frameMemory = beginTemporaryMemory(&renderArena);
+            RenderCommands commands;
+            RasterFrame rasterFrame;
+            beginRenderCommands(&commands, &renderArena, screenWidth, screenHeight);
+            GameRender(state, &commands, alpha);
+            bool binned = beginRasterFrame(&rasterFrame, &renderArena, &commands, &target);
+            Assert(binned);
+            linuxRasterizeFrame(pool, &rasterFrame);
+            endTemporaryMemory(frameMemory);
+            
+            double frameEnd = linuxGetSeconds();
+            lastFrameStart = frameStart;
+            frameSeconds[frameCount++] = frameEnd - lastFrameEnd;
+            lastFrameEnd = frameEnd;
+            if(pendingSequence && state->inputSequence >= pendingSequence)
+            {
+                latencySeconds[latencyCount++] = frameEnd - pendingSeconds;
+                pendingSequence = 0;
+            }
+        }
+        double elapsed = lastFrameEnd - start;
+        
+        if(threaded)
+        {
+            __atomic_store_n(&sim.quit, true, __ATOMIC_RELAXED);
+            pthread_join(simThread, 0);
+        }
+        linuxStopRasterPool(pool);
+        free(pool);
+        
+        double latencyTotal = 0;
+        for(int i = 0;
+            i < latencyCount;
+            i++)
+        {
+            latencyTotal += latencySeconds[i];
+        }
+        double latencyMean = latencyCount ? latencyTotal / latencyCount : 0;
+        double frameP99 = linuxPercentile(frameSeconds, frameCount, 0.99);
+        double latencyP99 = linuxPercentile(latencySeconds, latencyCount, 0.99);
+        double latencyMax = linuxPercentile(latencySeconds, latencyCount, 1.0);
+        printf("%9s %8d %10.3f %10.3f %12.2f %10.2f %10.2f %10.1f\n", threaded ? "threaded" : "single", frameCount,
+               elapsed * 1000.0 / frameCount, frameP99 * 1000.0, latencyMean * 1000.0, latencyP99 * 1000.0,
+               latencyMax * 1000.0, (sim.ticks - 1) / elapsed);
+        
+        linuxFreeArena(&renderArena);
+        linuxFreeArena(&transient);
+        linuxFreeArena(&arena);
+    }
+    
+    free(latencySeconds);
+    free(frameSeconds);
+}
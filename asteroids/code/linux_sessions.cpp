@@ -0,0 +1,417 @@
+// Work-stealing scheduler for many independent game sessions in one process.
+//
+// Sessions are cut into jobs of SESSION_JOB_SIZE sessions each. Every worker
+// starts with a contiguous run of jobs in its own deque and allocates those
+// sessions' GameStates from its own arena slice, on its own thread, so the
+// pages land near the core that will mostly touch them. A worker pops jobs
+// from the bottom of its deque and, once it runs dry, steals from the top of
+// a random victim's deque, so stolen work is always the coldest batch.
+// Scratch belongs to the worker running a job, not to the one that created
+// its sessions.
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define SESSION_JOB_SIZE 16
+#define SESSION_MAX_WORKERS 256
+#define SESSION_TRANSIENT_SIZE MEGABYTES(1)
+
+typedef struct
+{
+    GameState *gs;
+    long long gamesPlayed;
+} LinuxSession;
+
+typedef struct
+{
+    int firstSession;
+    int sessionCount;
+} LinuxSessionJob;
+
+// NOTE(trist007): Chase-Lev deque without growth. All jobs get pushed before
+// the workers start, after that the owner only pops and thieves only steal.
+// Cache line aligned so workers don't false share each other's indices.
+typedef struct __attribute__((aligned(64)))
+{
+    volatile long long top;
+    char pad0[64 - sizeof(long long)];
+    volatile long long bottom;
+    char pad1[64 - sizeof(long long)];
+    
+    int *jobs;
+    long long capacity;
+    
+    struct LinuxSessionPool *pool;
+    Arena arena;
+    
+    // Scratch for whichever job this worker is running, stolen ones too.
+    // Sessions get pointed at it right before they tick.
+    Arena transient;
+    pthread_t thread;
+    int index;
+    unsigned int stealSeed;
+    
+    // Stats
+    double startSeconds;
+    double endSeconds;
+    long long jobsRun;
+    long long jobsStolen;
+    long long stealMisses;
+} LinuxWorker;
+
+typedef struct LinuxSessionPool
+{
+    int workerCount;
+    LinuxWorker *workers;
+    
+    int sessionCount;
+    LinuxSession *sessions;
+    
+    int jobCount;
+    LinuxSessionJob *sessionJobs;
+    
+    long long ticksPerJob;
+    volatile long long jobsRemaining;
+    
+    pthread_barrier_t ready;
+} LinuxSessionPool;
+
+#define JOB_EMPTY -1
+
+static void
+linuxDequePush(LinuxWorker *worker, int job)
+{
+    long long b = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED);
+    Assert(b - __atomic_load_n(&worker->top, __ATOMIC_RELAXED) < worker->capacity);
+    worker->jobs[b % worker->capacity] = job;
+    __atomic_store_n(&worker->bottom, b + 1, __ATOMIC_RELEASE);
+}
+
+// Owner only
+static int
+linuxDequePop(LinuxWorker *worker)
+{
+    long long b = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&worker->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long long t = __atomic_load_n(&worker->top, __ATOMIC_RELAXED);
+    
+    int job = JOB_EMPTY;
+    if(t <= b)
+    {
+        job = worker->jobs[b % worker->capacity];
+        if(t == b)
+        {
+            // Last one, race the thieves for it
+            if(!__atomic_compare_exchange_n(&worker->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            {
+                job = JOB_EMPTY;
+            }
+            __atomic_store_n(&worker->bottom, b + 1, __ATOMIC_RELAXED);
+        }
+    }
+    else
+    {
+        __atomic_store_n(&worker->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return(job);
+}
+
+// Any thread
+static int
+linuxDequeSteal(LinuxWorker *victim)
+{
+    long long t = __atomic_load_n(&victim->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long long b = __atomic_load_n(&victim->bottom, __ATOMIC_ACQUIRE);
+    
+    int job = JOB_EMPTY;
+    if(t < b)
+    {
+        job = victim->jobs[t % victim->capacity];
+        if(!__atomic_compare_exchange_n(&victim->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        {
+            job = JOB_EMPTY;
+        }
+    }
+    return(job);
+}
+
+static void
+linuxRunSessionJob(LinuxWorker *worker, int job)
+{
+    LinuxSessionPool *pool = worker->pool;
+    LinuxSessionJob *sessionJob = pool->sessionJobs + job;
+    for(int s = 0;
+        s < sessionJob->sessionCount;
+        s++)
+    {
+        int sessionIndex = sessionJob->firstSession + s;
+        LinuxSession *session = pool->sessions + sessionIndex;
+        
+        // NOTE(trist007): the worker that created the session may be ticking
+        // its own jobs in its scratch right now, a stolen session can't use it
+        session->gs->transient = &worker->transient;
+        for(long long tick = 0;
+            tick < pool->ticksPerJob;
+            tick++)
+        {
+            GameInput input = linuxBotInput(tick, sessionIndex);
+            GameUpdate(session->gs, &input, SIM_DT);
+            if(session->gs->gameOver)
+            {
+                initializeGameState(session->gs, session->gs->transient, randomNext(&session->gs->random));
+                session->gamesPlayed++;
+            }
+        }
+    }
+}
+
+static void *
+linuxSessionWorkerProc(void *param)
+{
+    LinuxWorker *worker = (LinuxWorker *)param;
+    LinuxSessionPool *pool = worker->pool;
+    
+    // First touch: the sessions this worker starts out owning live in its slice
+    GameConfig config = defaultGameConfig();
+    long long t = __atomic_load_n(&worker->top, __ATOMIC_RELAXED);
+    long long b = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED);
+    for(long long i = t;
+        i < b;
+        i++)
+    {
+        LinuxSessionJob *sessionJob = pool->sessionJobs + worker->jobs[i % worker->capacity];
+        for(int s = 0;
+            s < sessionJob->sessionCount;
+            s++)
+        {
+            LinuxSession *session = pool->sessions + sessionJob->firstSession + s;
+            session->gs = pushGameState(&worker->arena, &config);
+            Assert(session->gs);
+            
+            // Seeded by session, not worker, so results don't depend on who ran it
+            initializeGameState(session->gs, &worker->transient, sessionJob->firstSession + s + 1);
+            session->gamesPlayed = 0;
+        }
+    }
+    
+    pthread_barrier_wait(&pool->ready);
+    worker->startSeconds = linuxGetSeconds();
+    
+    while(__atomic_load_n(&pool->jobsRemaining, __ATOMIC_ACQUIRE) > 0)
+    {
+        int job = linuxDequePop(worker);
+        if(job == JOB_EMPTY && pool->workerCount > 1)
+        {
+            // Out of local work, go take the oldest batch from someone else
+            worker->stealSeed = worker->stealSeed * 1103515245 + 12345;
+            int victim = (worker->stealSeed >> 16) % pool->workerCount;
+            if(victim != worker->index)
+            {
+                job = linuxDequeSteal(pool->workers + victim);
+                if(job != JOB_EMPTY) worker->jobsStolen++;
+                else worker->stealMisses++;
+            }
+        }
+        
+        if(job != JOB_EMPTY)
+        {
+            linuxRunSessionJob(worker, job);
+            worker->jobsRun++;
+            __atomic_fetch_sub(&pool->jobsRemaining, 1, __ATOMIC_RELEASE);
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+    
+    worker->endSeconds = linuxGetSeconds();
+    return(0);
+}
+
+// Runs every session for ticksPerSession ticks across workerCount threads.
+// Everything, including each worker's slice, comes out of the given arena.
+// With stealAll every job starts on worker 0 and the others only get work
+// by stealing. Each session's end state goes into fingerprint.
+static void
+linuxRunSessionPool(Arena *arena, int workerCount, int sessionCount, long long ticksPerSession, bool stealAll,
+                    unsigned long long *fingerprint)
+{
+    Assert(workerCount > 0 && workerCount <= SESSION_MAX_WORKERS);
+    
+    // NOTE(trist007): the caller sizes the arena for all of it, running out
+    // is a bug there
+    LinuxSessionPool *pool = arena_push(arena, LinuxSessionPool);
+    Assert(pool);
+    pool->workerCount = workerCount;
+    pool->sessionCount = sessionCount;
+    pool->sessions = arena_push_array(arena, LinuxSession, sessionCount);
+    pool->jobCount = (sessionCount + SESSION_JOB_SIZE - 1) / SESSION_JOB_SIZE;
+    pool->sessionJobs = arena_push_array(arena, LinuxSessionJob, pool->jobCount);
+    pool->ticksPerJob = ticksPerSession;
+    pool->jobsRemaining = pool->jobCount;
+    pool->workers = arena_push_array(arena, LinuxWorker, workerCount);
+    Assert(pool->sessions && pool->sessionJobs && pool->workers);
+    
+    for(int job = 0;
+        job < pool->jobCount;
+        job++)
+    {
+        pool->sessionJobs[job].firstSession = job * SESSION_JOB_SIZE;
+        pool->sessionJobs[job].sessionCount = sessionCount - job * SESSION_JOB_SIZE;
+        if(pool->sessionJobs[job].sessionCount > SESSION_JOB_SIZE)
+        {
+            pool->sessionJobs[job].sessionCount = SESSION_JOB_SIZE;
+        }
+    }
+    
+    // Each worker gets a contiguous run of jobs and a slice big enough for
+    // the sessions in them
+    int jobsPerWorker = (pool->jobCount + workerCount - 1) / workerCount;
+    if(stealAll) jobsPerWorker = pool->jobCount;
+    GameConfig config = defaultGameConfig();
+    size_t sliceSize = (size_t)jobsPerWorker * SESSION_JOB_SIZE * gameStateSize(&config);
+    for(int w = 0;
+        w < workerCount;
+        w++)
+    {
+        LinuxWorker *worker = pool->workers + w;
+        worker->top = 0;
+        worker->bottom = 0;
+        worker->capacity = pool->jobCount;
+        worker->jobs = arena_push_array(arena, int, pool->jobCount);
+        worker->pool = pool;
+        worker->arena = arena_sub(arena, sliceSize);
+        worker->transient = arena_sub(arena, SESSION_TRANSIENT_SIZE);
+        Assert(worker->jobs && worker->arena.base && worker->transient.base);
+        worker->index = w;
+        worker->stealSeed = 0x9e3779b9u * (w + 1);
+        worker->jobsRun = 0;
+        worker->jobsStolen = 0;
+        worker->stealMisses = 0;
+        
+        int firstJob = w * jobsPerWorker;
+        int endJob = firstJob + jobsPerWorker;
+        if(firstJob > pool->jobCount) firstJob = pool->jobCount;
+        if(endJob > pool->jobCount) endJob = pool->jobCount;
+        for(int job = firstJob;
+            job < endJob;
+            job++)
+        {
+            linuxDequePush(worker, job);
+        }
+    }
+    
+    pthread_barrier_init(&pool->ready, 0, workerCount + 1);
+    for(int w = 0;
+        w < workerCount;
+        w++)
+    {
+        pthread_create(&pool->workers[w].thread, 0, linuxSessionWorkerProc, pool->workers + w);
+    }
+    
+    pthread_barrier_wait(&pool->ready);
+    
+    for(int w = 0;
+        w < workerCount;
+        w++)
+    {
+        pthread_join(pool->workers[w].thread, 0);
+    }
+    pthread_barrier_destroy(&pool->ready);
+    
+    // NOTE(trist007): timed by the workers themselves, on a busy machine
+    // they can be done before this thread even wakes up from the barrier
+    double start = pool->workers[0].startSeconds;
+    double end = pool->workers[0].endSeconds;
+    
+    long long stolen = 0;
+    long long minJobs = pool->jobCount;
+    long long maxJobs = 0;
+    for(int w = 0;
+        w < workerCount;
+        w++)
+    {
+        LinuxWorker *worker = pool->workers + w;
+        if(worker->startSeconds < start) start = worker->startSeconds;
+        if(worker->endSeconds > end) end = worker->endSeconds;
+        stolen += worker->jobsStolen;
+        if(worker->jobsRun < minJobs) minJobs = worker->jobsRun;
+        if(worker->jobsRun > maxJobs) maxJobs = worker->jobsRun;
+    }
+    
+    // Where the random series ended up and how many games it took, the same
+    // whoever ran the session
+    for(int i = 0;
+        i < sessionCount;
+        i++)
+    {
+        LinuxSession *session = pool->sessions + i;
+        RandomSeries *random = &session->gs->random;
+        fingerprint[i] = ((unsigned long long)random->s[0] << 32 | random->s[1]) ^
+                         ((unsigned long long)random->s[2] << 32 | random->s[3]) ^
+                         (unsigned long long)session->gamesPlayed * 0x9e3779b97f4a7c15ull;
+    }
+    
+    double elapsed = end - start;
+    double gameTicks = (double)sessionCount * ticksPerSession;
+    printf("%8d %10.3f %16.0f %10lld %7lld/%lld", workerCount, elapsed, gameTicks / elapsed,
+           stolen, minJobs, maxJobs);
+}
+
+// Scaling benchmark: same sessions and ticks with 1, 2, 4 ... maxWorkers
+// threads, then a run where every job has to be stolen. Every run has to
+// leave each session where the one worker run did.
+static void
+linuxRunSessions(int sessionCount, long long ticksPerSession, int maxWorkers)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if(maxWorkers <= 0) maxWorkers = (int)cores;
+    if(maxWorkers > SESSION_MAX_WORKERS) maxWorkers = SESSION_MAX_WORKERS;
+    
+    printf("%d sessions x %lld ticks, %ld cores online\n", sessionCount, ticksPerSession, cores);
+    printf("%8s %10s %16s %10s %15s %8s\n", "workers", "seconds", "game ticks/s", "stolen", "jobs min/max",
+           "check");
+    
+    unsigned long long *reference = (unsigned long long *)malloc(sessionCount * sizeof(unsigned long long));
+    unsigned long long *fingerprint = (unsigned long long *)malloc(sessionCount * sizeof(unsigned long long));
+    
+    GameConfig config = defaultGameConfig();
+    for(int workerCount = 1;
+        ;
+        workerCount *= 2)
+    {
+        if(workerCount > maxWorkers) workerCount = maxWorkers;
+        
+        size_t size = MEGABYTES(16) + (size_t)workerCount * SESSION_TRANSIENT_SIZE +
+            (size_t)sessionCount * gameStateSize(&config) * 2;
+        Arena arena = linuxAllocArena(size);
+        linuxRunSessionPool(&arena, workerCount, sessionCount, ticksPerSession, false,
+                            workerCount == 1 ? reference : fingerprint);
+        linuxFreeArena(&arena);
+        
+        bool same = workerCount == 1 || memcmp(reference, fingerprint, sessionCount * sizeof(unsigned long long)) == 0;
+        printf(" %8s\n", same ? "ok" : "DIFFERS");
+        
+        if(workerCount == maxWorkers) break;
+    }
+    
+    // Every job starts on worker 0, everybody else only steals. At least two
+    // workers, even on one core. Every worker's slice is sized for all of
+    // them, only worker 0's gets used.
+    int stealWorkers = maxWorkers < 2 ? 2 : maxWorkers;
+    size_t size = MEGABYTES(16) + (size_t)stealWorkers * SESSION_TRANSIENT_SIZE +
+        (size_t)stealWorkers * (sessionCount + SESSION_JOB_SIZE) * gameStateSize(&config);
+    Arena arena = linuxAllocArena(size);
+    linuxRunSessionPool(&arena, stealWorkers, sessionCount, ticksPerSession, true, fingerprint);
+    linuxFreeArena(&arena);
+    
+    bool same = memcmp(reference, fingerprint, sessionCount * sizeof(unsigned long long)) == 0;
+    printf(" %8s  steal only\n", same ? "ok" : "DIFFERS");
+    
+    free(fingerprint);
+    free(reference);
+}
@@ -4,534 +4,479 @@
 #include <windows.h>
 //#include <stdint.h>
 #include "raylib.h"
-#include "raymath.h"
 
-#define MAX_BULLETS 20
-#define MAX_LARGE_ASTEROIDS 8
-#define MAX_SMALL_ASTEROIDS 12
+#include "asteroids.cpp"
+#include "asteroids_replay.cpp"
+#include "asteroids_render.cpp"
 
-// Screen resolution
-int screenWidth = 1024;
-int screenHeight = 768;
+// NOTE(trist007): huge pages on windows need SeLockMemoryPrivilege and have
+// to be committed together with the reserve, so the page flags are ignored
+// and growable arenas always use normal pages here
+void *
+platformReserveMemory(size_t size, int pageFlags)
+{
+    void *memory = VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_READWRITE);
+    return(memory);
+}
 
-// Getting radius of screen windows for asteroid spawn
-float screenRadius = sqrtf((screenWidth * screenWidth) + (screenHeight * screenHeight)) / 2;
+size_t
+platformCommitMemory(void *base, size_t size, int pageFlags)
+{
+    size_t pageSize = 0;
+    if(VirtualAlloc(base, size, MEM_COMMIT, PAGE_READWRITE)) pageSize = 4096;
+    return(pageSize);
+}
 
-// Spawn margin so asteroid will not spawn within the screen
-float spawnMargin = 50.0f;
+void
+platformReleaseMemory(void *base, size_t size)
+{
+    VirtualFree(base, 0, MEM_RELEASE);
+}
 
-// Helper macros
-#define Assert(expr) if(!(expr)) { *(int *)0 = 0; }
-#define MEGABYTES(num) ((num) * 1024ULL * 1024ULL)
-#define arena_push(arena, type) (type *)arena_alloc(arena, sizeof(type))
+int
+platformMeasureText(const char *text, int fontSize)
+{
+    return(MeasureText(text, fontSize));
+}
 
-typedef struct
+// From rlgl.h, which raylib.lib has built in
+#define RL_TRIANGLES 0x0004
+extern "C"
 {
-    //uint8_t *base;
-    unsigned char *base;
-    size_t size;
-    size_t used;
-} Arena;
+    void rlBegin(int mode);
+    void rlEnd(void);
+    void rlVertex2f(float x, float y);
+    void rlColor4ub(unsigned char r, unsigned char g, unsigned char b, unsigned char a);
+    bool rlCheckRenderBatchLimit(int vertexCount);
+}
 
-typedef struct
+// NOTE(trist007): every instance in a batch goes into one rlBegin/rlEnd as
+// plain triangles off the prebuilt mesh, no trig and no call per circle.
+// rlgl flushes on its own when its vertex buffer fills up.
+static void
+win32DrawCircleInstances(RenderCircleInstances *instances, RenderCircleMesh *mesh)
 {
-    Vector2 pos;
-    Vector2 velocity;
-    Color color;
-    float thrust;
-    float friction;
-    float rotation;
-    float size;
-} Ship;
+    rlBegin(RL_TRIANGLES);
+    RenderInstance *instance = renderInstances(instances);
+    for(int i = 0;
+        i < instances->count;
+        i++, instance++)
+    {
+        rlCheckRenderBatchLimit(RENDER_CIRCLE_SEGMENTS * 3);
+        rlColor4ub(instance->color.r, instance->color.g, instance->color.b, instance->color.a);
+        
+        float c = cosf(instance->rotation) * instance->radius;
+        float s = sinf(instance->rotation) * instance->radius;
+        float cx = instance->center.x;
+        float cy = instance->center.y;
+        Vector2 *previous = mesh->vertex + RENDER_CIRCLE_SEGMENTS - 1;
+        for(int v = 0;
+            v < RENDER_CIRCLE_SEGMENTS;
+            v++)
+        {
+            // Same winding as raylib's own fans: center, next, previous
+            Vector2 *next = mesh->vertex + v;
+            rlVertex2f(cx, cy);
+            rlVertex2f(cx + next->x * c - next->y * s, cy + next->x * s + next->y * c);
+            rlVertex2f(cx + previous->x * c - previous->y * s, cy + previous->x * s + previous->y * c);
+            previous = next;
+        }
+    }
+    rlEnd();
+}
 
-typedef struct
+// The raylib backend, one draw call per command in the order they came
+static void
+win32DrawRenderCommands(RenderCommands *commands, RenderCircleMesh *mesh, RenderDrawStats *stats)
 {
-    Vector2 pos;
-    Vector2 velocity;
-    bool active;
-} Bullet;
+    *stats = {};
+    char text[RENDER_MAX_TEXT + 1];
+    for(RenderCommandHeader *header = firstRenderCommand(commands);
+        header;
+        header = nextRenderCommand(commands, header))
+    {
+        countRenderDraw(stats, header);
+        if(header->type == RENDER_CLEAR)
+        {
+            RenderClear *clear = (RenderClear *)(header + 1);
+            ClearBackground(clear->color);
+        }
+        else if(header->type == RENDER_CIRCLE)
+        {
+            RenderCircle *circle = (RenderCircle *)(header + 1);
+            DrawCircleV(circle->center, circle->radius, circle->color);
+        }
+        else if(header->type == RENDER_TRIANGLE)
+        {
+            RenderTriangle *triangle = (RenderTriangle *)(header + 1);
+            DrawTriangle(triangle->v1, triangle->v2, triangle->v3, triangle->color);
+        }
+        else if(header->type == RENDER_LINE)
+        {
+            RenderLine *line = (RenderLine *)(header + 1);
+            DrawLineV(line->from, line->to, line->color);
+        }
+        else if(header->type == RENDER_TEXT)
+        {
+            RenderText *entry = (RenderText *)(header + 1);
+            memcpy(text, renderTextChars(entry), entry->length);
+            text[entry->length] = 0;
+            DrawText(text, entry->x, entry->y, entry->fontSize, entry->color);
+        }
+        else if(header->type == RENDER_CIRCLE_INSTANCES)
+        {
+            win32DrawCircleInstances((RenderCircleInstances *)(header + 1), mesh);
+        }
+    }
+}
 
-typedef struct
+static double
+win32GetSeconds(void)
 {
-    Vector2 pos;
-    Vector2 velocity;
-    Vector2 direction;
-    int size;
-    bool active;
-} Asteroid;
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return((double)counter.QuadPart / (double)frequency.QuadPart);
+}
+
+// Held keys packed into Win32SimThread.input
+#define WIN32_INPUT_ROTATE_RIGHT 1
+#define WIN32_INPUT_ROTATE_LEFT 2
+#define WIN32_INPUT_THRUST 4
+#define WIN32_INPUT_REVERSE 8
 
+// NOTE(trist007): the simulation owns the game, the replay and the arenas
+// and ticks on its own thread at SIM_HZ. The main thread only polls the
+// keyboard and draws whatever state got published last, a slow frame
+// doesn't hold a tick back any more. Everything crossing over goes through
+// the counters below or the RenderStateBuffer.
 typedef struct
 {
-    // Assets
-    Ship ship;
-    Bullet bullet[MAX_BULLETS];
-    Asteroid largeAsteroid[MAX_LARGE_ASTEROIDS];
-    Asteroid smallAsteroid[MAX_SMALL_ASTEROIDS];
-    
-    // Asteroid attributes
-    float asteroidSpeed;
-    Vector2 asteroidTarget;
-    
-    // Implement difficulty where every 10 seconds 0.2f gets added
-    float asteroidSpeedMultiplier;
-    
-    // size of bullet
-    float bulletRadius;
-    float bulletSpeed;
-    
-    // Variables
-    bool gameOver;
-    
-    // Timer
-    float gameTimer;
-    float speedIncreaseInterval;
-    
-    float asteroidSpawnTimer;
-    float asteroidSpawnInterval;
+    GameState *gs;
+    GameConfig *config;
+    Arena *arena;
+    Arena *transient;
+    InputReplay *replay;
+    RenderStateBuffer *states;
     
-} GameState;
+    // Written by the main thread. Presses are counters so none get lost
+    // between two ticks, inputSequence goes up after every change.
+    volatile long input;
+    volatile long inputSequence;
+    volatile long firePresses;
+    volatile long replayPresses;
+    volatile long restartPresses;
+    volatile long restartSeed;
+    volatile long quit;
+} Win32SimThread;
 
-// Forward declarations / Function prototypes
-GameState *initializeGame(Arena *arena);
-void spawnSmallAsteroid(GameState *gs, Vector2 asteroidPos, Vector2 asteroidVelocity, Vector2 asteroidDirection);
-void *arena_alloc(Arena *a, size_t bytes);
+static DWORD WINAPI
+win32SimThreadProc(LPVOID param)
+{
+    Win32SimThread *sim = (Win32SimThread *)param;
+    InputReplay *replay = sim->replay;
+    long firesSeen = 0;
+    long replaySeen = 0;
+    long restartSeen = 0;
+    long long tick = 0;
+    
+    double nextTick = win32GetSeconds();
+    while(!sim->quit)
+    {
+        double now = win32GetSeconds();
+        if(now < nextTick)
+        {
+            Sleep(1);
+            continue;
+        }
+        
+        // Don't spiral trying to catch up after a long stall
+        if(now - nextTick > 0.25) nextTick = now;
+        nextTick += SIM_DT;
+        
+        // Sequence first, whatever it counts is in the keys read after it
+        long sequence = sim->inputSequence;
+        MemoryBarrier();
+        
+        // L cycles recording -> looped playback -> live
+        while(replaySeen != sim->replayPresses)
+        {
+            if(replay->state == REPLAY_IDLE) beginRecording(replay);
+            else if(replay->state == REPLAY_RECORDING) beginPlayback(replay);
+            else endReplay(replay);
+            replaySeen++;
+        }
+        
+        if(restartSeen != sim->restartPresses)
+        {
+            restartSeen = sim->restartPresses;
+            if(sim->gs->gameOver && replay->state != REPLAY_PLAYING)
+            {
+                sim->gs = initializeGame(sim->arena, sim->transient, (unsigned int)sim->restartSeed, sim->config);
+                
+                // A restart isn't a logged input, record from the new game on
+                if(replay->state == REPLAY_RECORDING) beginRecording(replay);
+            }
+        }
+        
+        long keys = sim->input;
+        GameInput input = {};
+        input.rotateRight = (keys & WIN32_INPUT_ROTATE_RIGHT) != 0;
+        input.rotateLeft = (keys & WIN32_INPUT_ROTATE_LEFT) != 0;
+        input.thrust = (keys & WIN32_INPUT_THRUST) != 0;
+        input.reverse = (keys & WIN32_INPUT_REVERSE) != 0;
+        
+        // One press per tick, a burst of them fires over the next few
+        if(firesSeen != sim->firePresses)
+        {
+            input.fire = true;
+            firesSeen++;
+        }
+        
+        // Playback overrides the keyboard, the tick runs on what was logged
+        if(replay->state == REPLAY_RECORDING) recordInput(replay, &input);
+        if(replay->state == REPLAY_PLAYING) playbackInput(replay, &input);
+        
+        GameUpdate(sim->gs, &input, SIM_DT);
+        tick++;
+        
+        RenderState *state = beginRenderStateWrite(sim->states);
+        captureRenderState(sim->gs, state);
+        state->replayState = replay->state;
+        state->replayLoops = replay->loops;
+        state->tick = tick;
+        state->inputSequence = sequence;
+        state->publishedSeconds = win32GetSeconds();
+        publishRenderState(sim->states);
+    }
+    return(0);
+}
 
 // Program main entry point
 int main(void)
 {
     InitWindow(screenWidth, screenHeight, "asteroids");
     
-    SetTargetFPS(60);
+    // NOTE(trist007): render is uncapped, the simulation runs at a fixed SIM_HZ
+    // on its own thread and the draw interpolates between its last two ticks
     
-    void *memory = VirtualAlloc(NULL, MEGABYTES(64), MEM_COMMIT | MEM_RESERVE ,PAGE_READWRITE);
+    // Reserve plenty of address space, pages only get committed as used
     Arena arena;
-    arena.base = (unsigned char *)memory;
-    arena.size = MEGABYTES(64);
-    arena.used = 0;
+    if(!arena_reserve(&arena, GIGABYTES(1), ARENA_PAGES_DEFAULT))
+    {
+        CloseWindow();
+        return(1);
+    }
+    
+    // Per frame scratch, wiped at the end of every tick
+    Arena transient;
+    if(!arena_reserve(&transient, MEGABYTES(256), ARENA_PAGES_DEFAULT))
+    {
+        arena_release(&arena);
+        CloseWindow();
+        return(1);
+    }
     
     // Initialize game_state
-    GameState *gs = initializeGame(&arena);
+    // NOTE(trist007): raylib seeds its generator from the clock, every
+    // game draws a fresh seed from it
+    GameConfig config = defaultGameConfig();
+    config.wrapWorld = true;
+    GameState *gs = initializeGame(&arena, &transient, (unsigned int)GetRandomValue(0, 0x7FFFFFFF), &config);
+    if(!gs)
+    {
+        CloseWindow();
+        return(1);
+    }
+    
+    // Start state copy and input log for L key record/playback
+    Arena replayStorage;
+    if(!arena_reserve(&replayStorage, MEGABYTES(256), ARENA_PAGES_DEFAULT))
+    {
+        arena_release(&transient);
+        arena_release(&arena);
+        CloseWindow();
+        return(1);
+    }
+    InputReplay replay;
+    initializeReplay(&replay, &arena, &replayStorage);
+    
+    // Render commands, rebuilt every frame by the main thread
+    Arena renderArena;
+    if(!arena_reserve(&renderArena, MEGABYTES(64), ARENA_PAGES_DEFAULT))
+    {
+        arena_release(&replayStorage);
+        arena_release(&transient);
+        arena_release(&arena);
+        CloseWindow();
+        return(1);
+    }
+    
+    // NOTE(trist007): three slots of every pool, the sim thread fills one
+    // while the main thread draws another. Their own arena: the game arena
+    // gets copied over by replay playback and reset by a restart, both on
+    // the sim thread while this one still draws from the buffer.
+    Arena stateArena;
+    if(!arena_reserve(&stateArena, MEGABYTES(256), ARENA_PAGES_DEFAULT))
+    {
+        arena_release(&renderArena);
+        arena_release(&replayStorage);
+        arena_release(&transient);
+        arena_release(&arena);
+        CloseWindow();
+        return(1);
+    }
+    RenderStateBuffer states;
+    if(!pushRenderStateBuffer(&stateArena, &states, &config))
+    {
+        arena_release(&stateArena);
+        arena_release(&renderArena);
+        arena_release(&replayStorage);
+        arena_release(&transient);
+        arena_release(&arena);
+        CloseWindow();
+        return(1);
+    }
+    
+    // Start off showing the new game until the first tick comes in
+    RenderState *first = beginRenderStateWrite(&states);
+    captureRenderState(gs, first);
+    first->publishedSeconds = win32GetSeconds();
+    publishRenderState(&states);
+    
+    Win32SimThread sim = {};
+    sim.gs = gs;
+    sim.config = &config;
+    sim.arena = &arena;
+    sim.transient = &transient;
+    sim.replay = &replay;
+    sim.states = &states;
+    HANDLE simThread = CreateThread(0, 0, win32SimThreadProc, &sim, 0, 0);
+    
+    // Input to photon: from the key change to the end of the first frame
+    // drawn from a tick that saw it
+    long keys = 0;
+    long sequence = 0;
+    long pendingSequence = 0;
+    double pendingSeconds = 0;
+    double latencyTotal = 0;
+    double latencyMax = 0;
+    long long latencyCount = 0;
+    double frameSeconds = 0;
+    double lastFrameEnd = win32GetSeconds();
+    
+    RenderCircleMesh circleMesh;
+    buildCircleMesh(&circleMesh);
+    RenderDrawStats drawStats = {};
     
     // Main game loop
     while(!WindowShouldClose())
     {
         //-----------------------------------------------------------------------------------------
-        // Update
+        // Input
         //-----------------------------------------------------------------------------------------
-        if(!gs->gameOver)
+        bool fresh;
+        RenderState *state = acquireRenderState(&states, &fresh);
+        
+        if(!state->gameOver)
         {
             if(IsKeyPressed(KEY_H))
             {
                 if(IsCursorHidden()) ShowCursor();
                 else HideCursor();
             }
-            
-            // Control ship with keyboard
-            if(IsKeyDown(KEY_RIGHT)) gs->ship.rotation += 0.05f;
-            if(IsKeyDown(KEY_LEFT)) gs->ship.rotation -= 0.05f;
-            if(IsKeyDown(KEY_UP))
-            {
-                gs->ship.velocity.x += sinf(gs->ship.rotation) * gs->ship.thrust;
-                gs->ship.velocity.y -= cosf(gs->ship.rotation) * gs->ship.thrust;
-            }
-            if(IsKeyDown(KEY_DOWN))
-            {
-                gs->ship.velocity.x -= sinf(gs->ship.rotation) * gs->ship.thrust;
-                gs->ship.velocity.y += cosf(gs->ship.rotation) * gs->ship.thrust;
-            }
-            if(IsKeyPressed(KEY_SPACE))
-            {
-                for(int i = 0;
-                    i < MAX_BULLETS;
-                    i++)
-                {
-                    if(!gs->bullet[i].active)
-                    {
-                        gs->bullet[i].active = true;
-                        gs->bullet[i].pos = gs->ship.pos;
-                        gs->bullet[i].velocity.x = sinf(gs->ship.rotation) * gs->bulletSpeed;
-                        gs->bullet[i].velocity.y = -cosf(gs->ship.rotation) * gs->bulletSpeed;
-                        break;
-                    }
-                }
-            }
-            
-            // Adjust asteroid speed
-            gs->gameTimer += GetFrameTime();
-            if(gs->gameTimer >= gs->speedIncreaseInterval)
-            {
-                gs->asteroidSpeedMultiplier += 0.5f;
-                gs->gameTimer = 0.0f;
-            }
-            
-            // Apply velocity and friction to shipPosition
-            gs->ship.pos.x += gs->ship.velocity.x;
-            gs->ship.pos.y += gs->ship.velocity.y;
-            
-            gs->ship.velocity.x *= gs->ship.friction;
-            gs->ship.velocity.y *= gs->ship.friction;
-            
-            // Update active bullets
-            for(int i = 0;
-                i < MAX_BULLETS;
-                i++)
-            {
-                if(gs->bullet[i].active)
-                {
-                    gs->bullet[i].pos.x += gs->bullet[i].velocity.x;
-                    gs->bullet[i].pos.y += gs->bullet[i].velocity.y;
-                    
-                    // Deactive if off screen
-                    if(gs->bullet[i].pos.x < 0 || gs->bullet[i].pos.x > screenWidth ||
-                       gs->bullet[i].pos.y < 0 || gs->bullet[i].pos.y > screenHeight)
-                    {
-                        gs->bullet[i].active = false;
-                    }
-                }
-            }
-            
-            gs->asteroidSpawnTimer += GetFrameTime();
-            
-            if(gs->asteroidSpawnTimer >= gs->asteroidSpawnInterval)
-            {
-                // Spawn asteroids
-                for(int i = 0;
-                    i < MAX_LARGE_ASTEROIDS;
-                    i++)
-                {
-                    if(!gs->largeAsteroid[i].active)
-                    {
-                        // Get random angle and scale for asteroid
-                        float angle = GetRandomValue(0, 360) * DEG2RAD;
-                        float spawnRadius = screenRadius + spawnMargin;
-                        
-                        gs->largeAsteroid[i].pos.x = screenWidth / 2.0f + cosf(angle) * spawnRadius;
-                        gs->largeAsteroid[i].pos.y = screenHeight / 2.0f + sinf(angle) * spawnRadius;
-                        
-                        gs->largeAsteroid[i].size = GetRandomValue(20, 80);
-                        gs->largeAsteroid[i].active = true;
-                        gs->largeAsteroid[i].direction = Vector2Normalize(Vector2Subtract(gs->asteroidTarget, gs->largeAsteroid[i].pos));
-                        gs->largeAsteroid[i].velocity = Vector2Scale(gs->largeAsteroid[i].direction, gs->asteroidSpeed * gs->asteroidSpeedMultiplier);
-                        
-                        // Only spawn one asteroid per interval
-                        gs->asteroidSpawnTimer = 0.0f;
-                        break;
-                    }
-                }
-            }
-            
-            // Update spawned asteroids
-            for(int i = 0;
-                i < MAX_LARGE_ASTEROIDS;
-                i++)
-            {
-                if(gs->largeAsteroid[i].active)
-                {
-                    gs->largeAsteroid[i].pos.x += gs->largeAsteroid[i].velocity.x;
-                    gs->largeAsteroid[i].pos.y += gs->largeAsteroid[i].velocity.y;
-                    
-                    // if asteroid goes off screen then de-spawn
-                    float margin = 200.0f;
-                    if(gs->largeAsteroid[i].pos.x < -margin || gs->largeAsteroid[i].pos.x > screenWidth + margin ||
-                       gs->largeAsteroid[i].pos.y < -margin || gs->largeAsteroid[i].pos.y > screenHeight + margin)
-                    {
-                        gs->largeAsteroid[i].active = false;
-                    }
-                }
-            }
-            
-            // Update spawned small asteroids
-            for(int i = 0;
-                i < MAX_SMALL_ASTEROIDS;
-                i++)
-            {
-                if(gs->smallAsteroid[i].active)
-                {
-                    gs->smallAsteroid[i].pos.x += gs->smallAsteroid[i].velocity.x;
-                    gs->smallAsteroid[i].pos.y += gs->smallAsteroid[i].velocity.y;
-                    
-                    // if asteroid goes off screen then de-spawn
-                    float margin = 175.00;
-                    if(gs->smallAsteroid[i].pos.x < -margin || gs->smallAsteroid[i].pos.x > screenWidth + margin ||
-                       gs->smallAsteroid[i].pos.y < -margin || gs->smallAsteroid[i].pos.y > screenHeight + margin)
-                    {
-                        gs->smallAsteroid[i].active = false;
-                    }
-                } 
-            }
-            
-            // Check for bullet asteroid collisions
-            for(int i = 0;
-                i < MAX_BULLETS;
-                i++)
-            {
-                if(gs->bullet[i].active)
-                {
-                    for(int j = 0;
-                        j < MAX_LARGE_ASTEROIDS;
-                        j++)
-                    {
-                        if(gs->largeAsteroid[j].active)
-                        {
-                            float distance = Vector2Distance(gs->bullet[i].pos, gs->largeAsteroid[j].pos);
-                            
-                            if(distance < (gs->largeAsteroid[j].size + gs->bulletRadius))
-                            {
-                                gs->bullet[i].active = false;
-                                gs->largeAsteroid[j].active = false;
-                                
-                                // Spawn 2 small asteroids
-                                spawnSmallAsteroid(gs, gs->largeAsteroid[j].pos, gs->largeAsteroid[j].velocity, gs->largeAsteroid[j].direction);
-                                spawnSmallAsteroid(gs, gs->largeAsteroid[j].pos, gs->largeAsteroid[j].velocity, gs->largeAsteroid[j].direction);
-                            }
-                        }
-                    }
-                    for(int k = 0;
-                        k < MAX_SMALL_ASTEROIDS;
-                        k++)
-                    {
-                        if(gs->smallAsteroid[k].active)
-                        {
-                            float distance = Vector2Distance(gs->bullet[i].pos, gs->smallAsteroid[k].pos);
-                            
-                            if(distance < (gs->smallAsteroid[k].size + gs->bulletRadius))
-                            {
-                                gs->bullet[i].active = false;
-                                gs->smallAsteroid[k].active = false;
-                            }
-                        }
-                    }
-                }
-            }
-            
-            // Check for asteroid player collisions
-            if(!gs->gameOver)
-            {
-                for(int i = 0;
-                    i < MAX_LARGE_ASTEROIDS;
-                    i++)
-                {
-                    if(gs->largeAsteroid[i].active)
-                    {
-                        float distance = Vector2Distance(gs->largeAsteroid[i].pos, gs->ship.pos);
-                        if(distance < (gs->largeAsteroid[i].size + gs->ship.size))
-                        {
-                            gs->gameOver = true;
-                            break;
-                        }
-                    }
-                }
-                for(int j = 0;
-                    j < MAX_SMALL_ASTEROIDS;
-                    j++)
-                {
-                    if(gs->smallAsteroid[j].active)
-                    {
-                        float distance = Vector2Distance(gs->smallAsteroid[j].pos, gs->ship.pos);
-                        if(distance < (gs->smallAsteroid[j].size + gs->ship.size))
-                        {
-                            gs->gameOver = true;
-                            break;
-                        }
-                    }
-                }
-            }
-            
-            // Check if player ship has gone offscreen only to wrap on the opposite end
-            // NOTE(trist007): if the ship moves very fast it can do multiple
-            // wraps so you can use the crossedOver bool
-            if(gs->ship.pos.x < 0 || gs->ship.pos.x > screenWidth ||
-               gs->ship.pos.y < 0 || gs->ship.pos.y > screenHeight)
-            {
-                // Wrap horizontally
-                if(gs->ship.pos.x < 0) gs->ship.pos.x = screenWidth;
-                if(gs->ship.pos.x > screenWidth) gs->ship.pos.x = 0;
-                
-                // Wrap veritcally
-                if(gs->ship.pos.y < 0) gs->ship.pos.y = screenHeight;
-                if(gs->ship.pos.y > screenHeight) gs->ship.pos.y = 0;
-            }
         }
         
-        //-----------------------------------------------------------------------------------------
-        // Draw
-        //-----------------------------------------------------------------------------------------
-        BeginDrawing();
+        long newKeys = 0;
+        if(IsKeyDown(KEY_RIGHT)) newKeys |= WIN32_INPUT_ROTATE_RIGHT;
+        if(IsKeyDown(KEY_LEFT)) newKeys |= WIN32_INPUT_ROTATE_LEFT;
+        if(IsKeyDown(KEY_UP)) newKeys |= WIN32_INPUT_THRUST;
+        if(IsKeyDown(KEY_DOWN)) newKeys |= WIN32_INPUT_REVERSE;
         
+        bool changed = newKeys != keys;
+        if(changed)
         {
-            ClearBackground(RAYWHITE);
-            
-            Vector2 v1 = {
-                gs->ship.pos.x + sinf(gs->ship.rotation) * gs->ship.size,
-                gs->ship.pos.y - cosf(gs->ship.rotation) * gs->ship.size
-            };
-            
-            Vector2 v2 = {
-                gs->ship.pos.x + sinf(gs->ship.rotation + 2.4f) * gs->ship.size,
-                gs->ship.pos.y - cosf(gs->ship.rotation + 2.4f) * gs->ship.size
-            };
-            
-            Vector2 v3 = {
-                gs->ship.pos.x + sinf(gs->ship.rotation - 2.4f) * gs->ship.size,
-                gs->ship.pos.y - cosf(gs->ship.rotation - 2.4f) * gs->ship.size
-            };
-            
-            DrawTriangle(v1, v3, v2, gs->ship.color);
-            DrawTriangleLines(v1, v3, v2, BLACK);
-            
-            // Draw bullets
-            for(int i = 0;
-                i < MAX_BULLETS;
-                i++)
-            {
-                if(gs->bullet[i].active)
-                {
-                    DrawCircleV(gs->bullet[i].pos, 3.0f, RED);
-                }
-            }
-            
-            // Draw asteroids
-            for(int i = 0;
-                i < MAX_LARGE_ASTEROIDS;
-                i++)
-            {
-                if(gs->largeAsteroid[i].active)
-                {
-                    DrawCircleV(gs->largeAsteroid[i].pos, gs->largeAsteroid[i].size, GRAY);
-                }
-            }
-            
-            // Draw small asteroids
-            for(int i = 0;
-                i < MAX_SMALL_ASTEROIDS;
-                i++)
-            {
-                if(gs->smallAsteroid[i].active)
-                {
-                    DrawCircleV(gs->smallAsteroid[i].pos, gs->smallAsteroid[i].size, GRAY);
-                }
-            }
-            
-            if(IsCursorHidden()) DrawText("CURSOR HIDDEN", 20, 60, 20, RED);
-            else DrawText("CURSOR VISIBLE", 20, 60, 20, LIME);
-            
+            keys = newKeys;
+            InterlockedExchange(&sim.input, keys);
+        }
+        if(IsKeyPressed(KEY_SPACE))
+        {
+            InterlockedIncrement(&sim.firePresses);
+            changed = true;
+        }
+        if(IsKeyPressed(KEY_L)) InterlockedIncrement(&sim.replayPresses);
+        if(state->gameOver && IsKeyPressed(KEY_R))
+        {
+            // raylib's generator stays on this thread
+            InterlockedExchange(&sim.restartSeed, GetRandomValue(0, 0x7FFFFFFF));
+            InterlockedIncrement(&sim.restartPresses);
         }
         
-        if(gs->gameOver)
+        if(changed)
         {
-            if(IsKeyPressed(KEY_R))
+            sequence = InterlockedIncrement(&sim.inputSequence);
+            if(!pendingSequence)
             {
-                gs = initializeGame(&arena);
+                pendingSequence = sequence;
+                pendingSeconds = win32GetSeconds();
             }
-            
-            int fontSize = 80;
-            int fontSize2 = 50;
-            const char *text = "GAME OVER";
-            const char *text2 = "hit R to restart";
-            int textWidth = MeasureText(text, fontSize);
-            DrawText(text, screenWidth / 2 - textWidth / 2, screenHeight / 2 - fontSize / 2, fontSize, RED);
-            DrawText(text2, screenWidth / 2 - textWidth / 2, (screenHeight / 2 - fontSize / 2) + 75, fontSize2, RED);
-            
-            
         }
         
+        // How far we are between the state's previous and current tick
+        float alpha = (float)((win32GetSeconds() - state->publishedSeconds) / SIM_DT);
+        if(alpha > 1.0f) alpha = 1.0f;
+        
+        //-----------------------------------------------------------------------------------------
+        // Draw
+        //-----------------------------------------------------------------------------------------
+        arena_reset(&renderArena);
+        RenderCommands commands;
+        beginRenderCommands(&commands, &renderArena, screenWidth, screenHeight);
+        GameRender(state, &commands, alpha);
+        
+        if(IsCursorHidden()) pushText(&commands, "CURSOR HIDDEN", 20, 60, 20, RED);
+        else pushText(&commands, "CURSOR VISIBLE", 20, 60, 20, LIME);
+        
+        if(state->replayState == REPLAY_RECORDING) pushText(&commands, "RECORDING", 20, 90, 20, RED);
+        if(state->replayState == REPLAY_PLAYING) pushText(&commands, TextFormat("PLAYBACK loop %lld", state->replayLoops + 1), 20, 90, 20, LIME);
+        
+        double latencyMean = latencyCount ? latencyTotal / latencyCount : 0;
+        pushText(&commands, TextFormat("frame %.2f ms  input %.1f ms (max %.1f)", frameSeconds * 1000.0, latencyMean * 1000.0, latencyMax * 1000.0),
+                 20, 120, 20, GRAY);
+        
+        // Last frame's, this one's only get counted while it draws
+        pushText(&commands, TextFormat("draws %d  vertices %lld", drawStats.drawCalls, drawStats.vertices), 20, 150, 20, GRAY);
+        
+        BeginDrawing();
+        win32DrawRenderCommands(&commands, &circleMesh, &drawStats);
         EndDrawing();
+        
+        double frameEnd = win32GetSeconds();
+        frameSeconds = frameEnd - lastFrameEnd;
+        lastFrameEnd = frameEnd;
+        if(pendingSequence && state->inputSequence >= pendingSequence)
+        {
+            double latency = frameEnd - pendingSeconds;
+            latencyTotal += latency;
+            if(latency > latencyMax) latencyMax = latency;
+            latencyCount++;
+            pendingSequence = 0;
+        }
         //-----------------------------------------------------------------------------------------
     }
     
+    InterlockedExchange(&sim.quit, 1);
+    WaitForSingleObject(simThread, INFINITE);
+    CloseHandle(simThread);
+    
     // De-Initialization
+    arena_release(&stateArena);
+    arena_release(&renderArena);
+    arena_release(&replayStorage);
+    arena_release(&transient);
+    arena_release(&arena);
     CloseWindow();
     
     return(0);
 }
-
-GameState *
-initializeGame(Arena *arena)
-{
-    arena->used = 0;
-    GameState *gs = arena_push(arena, GameState);
-    
-    gs->gameOver = false;
-    gs->speedIncreaseInterval = 10.0f;
-    gs->asteroidSpawnInterval = 1.0f;
-    
-    gs->asteroidSpeed = 2.0f;
-    gs->asteroidTarget = { screenWidth / 2.0f, screenHeight / 2.0f };
-    gs->asteroidSpeedMultiplier = 1.0f;
-    gs->bulletRadius = 3.0f;
-    gs->bulletSpeed = 10.0f;
-    
-    // Initialize ship
-    gs->ship.pos = { (float)screenWidth / 2, (float)screenHeight / 2 };
-    gs->ship.velocity = {};
-    gs->ship.rotation = 0.0f;
-    gs->ship.thrust = 0.1f;
-    gs->ship.friction = 0.99f; // 1.0 for no friction, lower = more friction
-    gs->ship.color = DARKBLUE;
-    gs->ship.size = 15.0f;
-    
-    // Initialize bullets
-    for(int i = 0;
-        i < MAX_BULLETS;
-        i++)
-    {
-        gs->bullet[i].active = false;
-    }
-    
-    // Initialize asteroids
-    for(int i = 0;
-        i < MAX_LARGE_ASTEROIDS;
-        i++)
-    {
-        gs->largeAsteroid[i].active = false;
-    }
-    
-    // Initialize small asteroids
-    for(int i = 0;
-        i < MAX_SMALL_ASTEROIDS;
-        i++)
-    {
-        gs->smallAsteroid[i].active = false;
-    }
-    
-    return(gs);
-}
-
-void
-spawnSmallAsteroid(GameState *gs, Vector2 asteroidPos, Vector2 asteroidVelocity, Vector2 asteroidDirection)
-{
-    for(int i = 0;
-        i < MAX_SMALL_ASTEROIDS;
-        i++)
-    {
-        if(!gs->smallAsteroid[i].active)
-        {
-            gs->smallAsteroid[i].pos.x = asteroidPos.x;
-            gs->smallAsteroid[i].pos.y = asteroidPos.y;
-            
-            gs->smallAsteroid[i].size = GetRandomValue(5, 10);
-            gs->smallAsteroid[i].active = true;
-            
-            // Add some spread
-            float spread = GetRandomValue(-40, 40) * DEG2RAD;
-            
-            gs->smallAsteroid[i].direction.x = asteroidDirection.x * cosf(spread) - asteroidDirection.y * sinf(spread);
-            gs->smallAsteroid[i].direction.y = asteroidDirection.x * sinf(spread) + asteroidDirection.y * cosf(spread);
-            
-            gs->smallAsteroid[i].velocity = Vector2Scale(gs->smallAsteroid[i].direction, gs->asteroidSpeed);
-            
-            // Only spawn one small asteroid
-            break;
-        }
-    }
-}
-
-void*
-arena_alloc(Arena *a, size_t bytes)
-{
-    Assert(a->used + bytes <= a->size);
-    void *ptr = a->base + a->used;
-    a->used += bytes;
-    return(ptr);
-}
-